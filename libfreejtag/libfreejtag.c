@@ -0,0 +1,615 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * FreeJTAG
+ * Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+ */
+
+#include <libusb.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libfreejtag.h"
+
+
+#define FREEJTAG_TIMEOUT                1000
+/* Shift lengths are sent as 16 bits, which caps a chunk at 8 KiB */
+#define FREEJTAG_MAX_ARENA              8192
+
+#define REQTYPE_OUT (LIBUSB_REQUEST_TYPE_VENDOR | \
+        LIBUSB_RECIPIENT_INTERFACE | LIBUSB_ENDPOINT_OUT)
+#define REQTYPE_IN  (LIBUSB_REQUEST_TYPE_VENDOR | \
+        LIBUSB_RECIPIENT_INTERFACE | LIBUSB_ENDPOINT_IN)
+
+typedef enum {
+    FREEJTAG_REQ_VERSION            = 0x00,
+    FREEJTAG_REQ_RESET,
+    FREEJTAG_REQ_EXECUTE,
+    FREEJTAG_REQ_READBUF,
+    FREEJTAG_REQ_BULKBYTE,
+    FREEJTAG_REQ_ARENA,
+    FREEJTAG_REQ_READOCDR           = 0x80,
+    FREEJTAG_REQ_XSVF,
+    FREEJTAG_REQ_OCDREGS,
+} freejtag_req_t;
+
+typedef enum {
+    FREEJTAG_CMD_NOP                = 0x00,
+    FREEJTAG_CMD_ATTACH,
+    FREEJTAG_CMD_SET_TDI,
+    FREEJTAG_CMD_SET_TMS,
+    FREEJTAG_CMD_SET_STATE,
+    FREEJTAG_CMD_CLOCK,
+    FREEJTAG_CMD_SHIFT,
+    FREEJTAG_CMD_SHIFT_EXIT,
+    FREEJTAG_CMD_SET_DELAY,
+    FREEJTAG_CMD_SHIFT_OUT          = 0x40,
+    FREEJTAG_CMD_SHIFT_IN           = 0x80,
+    FREEJTAG_CMD_SHIFT_OUTIN        = 0xC0,
+} freejtag_cmd_t;
+
+struct freejtag {
+    libusb_context *ctx;
+    libusb_device_handle *handle;
+    uint16_t ifnum;
+    /* Chunk size in bytes and a scratch buffer that large */
+    size_t arena;
+    uint8_t *buf;
+};
+
+static const char *const FreeJTAG_InterfaceString = "FreeJTAG Interface";
+
+static int FreeJTAG_Error(int error)
+{
+    switch (error) {
+    case LIBUSB_ERROR_ACCESS:
+        return FREEJTAG_ERROR_ACCESS;
+    case LIBUSB_ERROR_NO_DEVICE:
+    case LIBUSB_ERROR_NOT_FOUND:
+        return FREEJTAG_ERROR_NOT_FOUND;
+    case LIBUSB_ERROR_NO_MEM:
+        return FREEJTAG_ERROR_NO_MEMORY;
+    case LIBUSB_ERROR_INVALID_PARAM:
+        return FREEJTAG_ERROR_INVALID;
+    default:
+        return error < 0 ? FREEJTAG_ERROR_IO : FREEJTAG_OK;
+    }
+}
+
+static int FreeJTAG_Control(freejtag_t *dev, uint8_t reqtype,
+        uint8_t request, uint16_t value, uint16_t index, uint8_t *data,
+        uint16_t length)
+{
+    int ret;
+
+    ret = libusb_control_transfer(dev->handle, reqtype, request, value,
+            index | dev->ifnum, data, length, FREEJTAG_TIMEOUT);
+    if (ret < 0) {
+        return FreeJTAG_Error(ret);
+    }
+    return ret == length ? FREEJTAG_OK : FREEJTAG_ERROR_IO;
+}
+
+static int FreeJTAG_CtrlOut(freejtag_t *dev, uint8_t request, uint16_t value,
+        const uint8_t *data, uint16_t length)
+{
+    return FreeJTAG_Control(dev, REQTYPE_OUT, request, value, 0,
+            (uint8_t *) data, length);
+}
+
+static int FreeJTAG_CtrlIn(freejtag_t *dev, uint8_t request, uint16_t value,
+        uint8_t *data, uint16_t length)
+{
+    return FreeJTAG_Control(dev, REQTYPE_IN, request, value, 0, data, length);
+}
+
+static int FreeJTAG_Execute(freejtag_t *dev, uint8_t cmd, uint16_t arg,
+        const uint8_t *data, uint16_t length)
+{
+    /* Shift lengths past 256 bits carry their high byte in wIndex */
+    return FreeJTAG_Control(dev, REQTYPE_OUT, FREEJTAG_REQ_EXECUTE,
+            ((arg & 0xff) << 8) | cmd, arg & 0xff00, (uint8_t *) data, length);
+}
+
+static size_t FreeJTAG_QueryArena(freejtag_t *dev)
+{
+    uint8_t data[2];
+    size_t size;
+
+    /* Older firmware stalls the request */
+    if (FreeJTAG_CtrlIn(dev, FREEJTAG_REQ_ARENA, 0, data, sizeof(data)) !=
+            FREEJTAG_OK) {
+        return FREEJTAG_DEFAULT_ARENA;
+    }
+    size = data[0] | (data[1] << 8);
+    if (size == 0) {
+        return FREEJTAG_DEFAULT_ARENA;
+    }
+    return size < FREEJTAG_MAX_ARENA ? size : FREEJTAG_MAX_ARENA;
+}
+
+static bool FreeJTAG_MatchString(libusb_device_handle *handle, uint8_t index,
+        const char *match)
+{
+    char string[64];
+    int ret;
+
+    if (!index) {
+        return false;
+    }
+    ret = libusb_get_string_descriptor_ascii(handle, index,
+            (unsigned char *) string, sizeof(string));
+    return ret >= 0 && strcmp(string, match) == 0;
+}
+
+static int FreeJTAG_FindInterface(libusb_device *device,
+        libusb_device_handle *handle)
+{
+    struct libusb_config_descriptor *config;
+    int ifnum = -1;
+
+    if (libusb_get_active_config_descriptor(device, &config) < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < config->bNumInterfaces && ifnum < 0; i++) {
+        const struct libusb_interface *intf = &config->interface[i];
+
+        for (int j = 0; j < intf->num_altsetting; j++) {
+            const struct libusb_interface_descriptor *alt =
+                    &intf->altsetting[j];
+
+            if (FreeJTAG_MatchString(handle, alt->iInterface,
+                    FreeJTAG_InterfaceString)) {
+                ifnum = alt->bInterfaceNumber;
+                break;
+            }
+        }
+    }
+
+    libusb_free_config_descriptor(config);
+    return ifnum;
+}
+
+int freejtag_open(freejtag_t **dev, uint16_t vid, uint16_t pid, int index,
+        const char *serial)
+{
+    libusb_device **list;
+    freejtag_t *self;
+    ssize_t count;
+    int ret = FREEJTAG_ERROR_NOT_FOUND;
+
+    if (!dev || index < 0) {
+        return FREEJTAG_ERROR_INVALID;
+    }
+
+    self = calloc(1, sizeof(*self));
+    if (!self) {
+        return FREEJTAG_ERROR_NO_MEMORY;
+    }
+
+    if (libusb_init(&self->ctx) < 0) {
+        free(self);
+        return FREEJTAG_ERROR_IO;
+    }
+
+    count = libusb_get_device_list(self->ctx, &list);
+    for (ssize_t i = 0; i < count && !self->handle; i++) {
+        struct libusb_device_descriptor desc;
+        libusb_device_handle *handle;
+        int ifnum, err;
+
+        if (libusb_get_device_descriptor(list[i], &desc) < 0 ||
+                desc.idVendor != vid || desc.idProduct != pid) {
+            continue;
+        }
+
+        err = libusb_open(list[i], &handle);
+        if (err < 0) {
+            ret = FreeJTAG_Error(err);
+            continue;
+        }
+
+        if (serial && !FreeJTAG_MatchString(handle, desc.iSerialNumber,
+                serial)) {
+            libusb_close(handle);
+            continue;
+        }
+
+        ifnum = FreeJTAG_FindInterface(list[i], handle);
+        if (ifnum < 0 || index-- > 0) {
+            libusb_close(handle);
+            continue;
+        }
+
+        err = libusb_claim_interface(handle, ifnum);
+        if (err < 0) {
+            ret = FreeJTAG_Error(err);
+            libusb_close(handle);
+            break;
+        }
+
+        self->handle = handle;
+        self->ifnum = ifnum;
+    }
+    if (count >= 0) {
+        libusb_free_device_list(list, 1);
+    }
+
+    if (self->handle) {
+        self->arena = FreeJTAG_QueryArena(self);
+        self->buf = malloc(self->arena);
+        if (!self->buf) {
+            ret = FREEJTAG_ERROR_NO_MEMORY;
+            libusb_release_interface(self->handle, self->ifnum);
+            libusb_close(self->handle);
+            self->handle = NULL;
+        }
+    }
+
+    if (!self->handle) {
+        libusb_exit(self->ctx);
+        free(self);
+        return ret;
+    }
+
+    *dev = self;
+    return FREEJTAG_OK;
+}
+
+void freejtag_close(freejtag_t *dev)
+{
+    if (!dev) {
+        return;
+    }
+    libusb_release_interface(dev->handle, dev->ifnum);
+    libusb_close(dev->handle);
+    libusb_exit(dev->ctx);
+    free(dev->buf);
+    free(dev);
+}
+
+const char *freejtag_strerror(int error)
+{
+    switch (error) {
+    case FREEJTAG_OK:
+        return "Success";
+    case FREEJTAG_ERROR_NOT_FOUND:
+        return "No devices found";
+    case FREEJTAG_ERROR_ACCESS:
+        return "Error accessing device, check permissions";
+    case FREEJTAG_ERROR_IO:
+        return "Input/output error";
+    case FREEJTAG_ERROR_INVALID:
+        return "Invalid argument";
+    case FREEJTAG_ERROR_NO_MEMORY:
+        return "Out of memory";
+    default:
+        return "Unknown error";
+    }
+}
+
+int freejtag_version(freejtag_t *dev, uint16_t *version)
+{
+    uint8_t data[2];
+    int ret;
+
+    ret = FreeJTAG_CtrlIn(dev, FREEJTAG_REQ_VERSION, 0, data, sizeof(data));
+    if (ret == FREEJTAG_OK) {
+        *version = data[0] | (data[1] << 8);
+    }
+    return ret;
+}
+
+size_t freejtag_arena_size(freejtag_t *dev)
+{
+    return dev->arena;
+}
+
+int freejtag_reset(freejtag_t *dev)
+{
+    return FreeJTAG_CtrlOut(dev, FREEJTAG_REQ_RESET, 0, NULL, 0);
+}
+
+int freejtag_attach(freejtag_t *dev, bool attach)
+{
+    return FreeJTAG_Execute(dev, FREEJTAG_CMD_ATTACH, attach, NULL, 0);
+}
+
+int freejtag_set_tdi(freejtag_t *dev, bool value)
+{
+    return FreeJTAG_Execute(dev, FREEJTAG_CMD_SET_TDI, value, NULL, 0);
+}
+
+int freejtag_set_tms(freejtag_t *dev, bool value)
+{
+    return FreeJTAG_Execute(dev, FREEJTAG_CMD_SET_TMS, value, NULL, 0);
+}
+
+int freejtag_set_state(freejtag_t *dev, uint8_t state)
+{
+    return FreeJTAG_Execute(dev, FREEJTAG_CMD_SET_STATE, state, NULL, 0);
+}
+
+int freejtag_clock(freejtag_t *dev, size_t cycles)
+{
+    int ret = FREEJTAG_OK;
+
+    while (cycles > 0 && ret == FREEJTAG_OK) {
+        size_t chunk = cycles < 256 ? cycles : 256;
+
+        ret = FreeJTAG_Execute(dev, FREEJTAG_CMD_CLOCK, chunk - 1, NULL, 0);
+        cycles -= chunk;
+    }
+    return ret;
+}
+
+int freejtag_set_tck_delay(freejtag_t *dev, uint8_t delay)
+{
+    return FreeJTAG_Execute(dev, FREEJTAG_CMD_SET_DELAY, delay, NULL, 0);
+}
+
+int freejtag_shift(freejtag_t *dev, size_t bits, bool exit)
+{
+    return freejtag_scan(dev, NULL, 0, NULL, 0, bits, exit);
+}
+
+void freejtag_bitcopy(uint8_t *dst, size_t dst_offset, const uint8_t *src,
+        size_t src_offset, size_t bits)
+{
+    dst += dst_offset / 8;
+    dst_offset %= 8;
+    src += src_offset / 8;
+    src_offset %= 8;
+
+    if (dst_offset == 0 && src_offset == 0) {
+        memcpy(dst, src, bits / 8);
+        dst += bits / 8;
+        src += bits / 8;
+        bits %= 8;
+    }
+
+    for (size_t i = 0; i < bits; i++) {
+        size_t s = src_offset + i, d = dst_offset + i;
+        uint8_t mask = 1 << (d & 7);
+
+        if (src[s >> 3] & (1 << (s & 7))) {
+            dst[d >> 3] |= mask;
+        } else {
+            dst[d >> 3] &= ~mask;
+        }
+    }
+}
+
+typedef struct {
+    const freejtag_segment_t *segment;
+    const freejtag_segment_t *end;
+    size_t offset;
+} freejtag_cursor_t;
+
+static void FreeJTAG_CursorSkip(freejtag_cursor_t *cursor)
+{
+    while (cursor->segment < cursor->end &&
+            cursor->offset >= cursor->segment->bits) {
+        cursor->segment++;
+        cursor->offset = 0;
+    }
+}
+
+/*
+ * Walk the next 'bits' bits of the segment list.  Gathers TDI into 'out' and,
+ * when 'in' is set, scatters captured TDO back to the caller's buffers.
+ */
+static void FreeJTAG_Transfer(freejtag_cursor_t *cursor, uint8_t *out,
+        const uint8_t *in, size_t bits)
+{
+    size_t pos = 0;
+
+    while (pos < bits) {
+        const freejtag_segment_t *seg;
+        size_t n;
+
+        FreeJTAG_CursorSkip(cursor);
+        seg = cursor->segment;
+        n = seg->bits - cursor->offset;
+        if (n > bits - pos) {
+            n = bits - pos;
+        }
+
+        if (out && seg->tdi) {
+            freejtag_bitcopy(out, pos, seg->tdi,
+                    seg->tdi_offset + cursor->offset, n);
+        }
+        if (in && seg->tdo) {
+            freejtag_bitcopy(seg->tdo, seg->tdo_offset + cursor->offset, in,
+                    pos, n);
+        }
+
+        cursor->offset += n;
+        pos += n;
+    }
+}
+
+static void FreeJTAG_Inspect(freejtag_cursor_t cursor, size_t bits,
+        bool *has_tdi, bool *has_tdo, const uint8_t **direct_tdi,
+        uint8_t **direct_tdo)
+{
+    const freejtag_segment_t *seg;
+
+    *has_tdi = *has_tdo = false;
+    *direct_tdi = NULL;
+    *direct_tdo = NULL;
+
+    FreeJTAG_CursorSkip(&cursor);
+    seg = cursor.segment;
+    if (seg->bits - cursor.offset >= bits) {
+        /* Whole chunk in one byte aligned segment: use caller memory */
+        if (seg->tdi && (seg->tdi_offset + cursor.offset) % 8 == 0) {
+            *direct_tdi = seg->tdi + (seg->tdi_offset + cursor.offset) / 8;
+        }
+        if (seg->tdo && (seg->tdo_offset + cursor.offset) % 8 == 0 &&
+                bits % 8 == 0) {
+            *direct_tdo = seg->tdo + (seg->tdo_offset + cursor.offset) / 8;
+        }
+    }
+
+    while (bits > 0 && seg < cursor.end) {
+        size_t n = seg->bits - cursor.offset;
+
+        if (n > bits) {
+            n = bits;
+        }
+        *has_tdi |= seg->tdi != NULL && n > 0;
+        *has_tdo |= seg->tdo != NULL && n > 0;
+        bits -= n;
+        seg++;
+        cursor.offset = 0;
+    }
+}
+
+int freejtag_scan_sg(freejtag_t *dev, const freejtag_segment_t *segments,
+        size_t count, bool exit)
+{
+    freejtag_cursor_t cursor = { segments, segments + count, 0 };
+    const size_t max_bits = dev->arena * 8;
+    size_t remaining = 0;
+    int ret = FREEJTAG_OK;
+
+    for (size_t i = 0; i < count; i++) {
+        remaining += segments[i].bits;
+    }
+    if (remaining == 0) {
+        return exit ? FREEJTAG_ERROR_INVALID : FREEJTAG_OK;
+    }
+
+    while (remaining > 0 && ret == FREEJTAG_OK) {
+        size_t bits = remaining < max_bits ? remaining : max_bits;
+        size_t length = (bits + 7) / 8;
+        bool last_exit = exit && bits == remaining;
+        freejtag_cursor_t start = cursor;
+        bool has_tdi, has_tdo;
+        const uint8_t *tdi;
+        uint8_t *tdo;
+        uint8_t cmd;
+
+        FreeJTAG_Inspect(cursor, bits, &has_tdi, &has_tdo, &tdi, &tdo);
+
+        if (has_tdi && !tdi) {
+            memset(dev->buf, 0, length);
+            FreeJTAG_Transfer(&cursor, dev->buf, NULL, bits);
+            tdi = dev->buf;
+        } else {
+            FreeJTAG_Transfer(&cursor, NULL, NULL, bits);
+        }
+
+        if (has_tdi && has_tdo) {
+            cmd = FREEJTAG_CMD_SHIFT_OUTIN;
+        } else if (has_tdi) {
+            cmd = FREEJTAG_CMD_SHIFT_OUT;
+        } else if (has_tdo) {
+            cmd = FREEJTAG_CMD_SHIFT_IN;
+        } else {
+            cmd = FREEJTAG_CMD_SHIFT;
+        }
+        cmd |= last_exit;
+
+        ret = FreeJTAG_Execute(dev, cmd, bits - 1, has_tdi ? tdi : NULL,
+                has_tdi ? length : 0);
+        if (ret == FREEJTAG_OK && has_tdo) {
+            ret = FreeJTAG_CtrlIn(dev, FREEJTAG_REQ_READBUF, 0,
+                    tdo ? tdo : dev->buf, length);
+            if (ret == FREEJTAG_OK && !tdo) {
+                FreeJTAG_Transfer(&start, NULL, dev->buf, bits);
+            }
+        }
+
+        remaining -= bits;
+    }
+
+    return ret;
+}
+
+int freejtag_scan(freejtag_t *dev, const uint8_t *tdi, size_t tdi_offset,
+        uint8_t *tdo, size_t tdo_offset, size_t bits, bool exit)
+{
+    freejtag_segment_t segment = {
+        .tdi = tdi,
+        .tdi_offset = tdi_offset,
+        .tdo = tdo,
+        .tdo_offset = tdo_offset,
+        .bits = bits,
+    };
+
+    return freejtag_scan_sg(dev, &segment, 1, exit);
+}
+
+int freejtag_bulk_write(freejtag_t *dev, const uint8_t *data, size_t length)
+{
+    int ret = FREEJTAG_OK;
+
+    while (length > 0 && ret == FREEJTAG_OK) {
+        size_t chunk = length < dev->arena ? length : dev->arena;
+
+        ret = FreeJTAG_CtrlOut(dev, FREEJTAG_REQ_BULKBYTE, 0, data, chunk);
+        data += chunk;
+        length -= chunk;
+    }
+    return ret;
+}
+
+int freejtag_bulk_read(freejtag_t *dev, uint8_t *data, size_t length)
+{
+    int ret = FREEJTAG_OK;
+
+    while (length > 0 && ret == FREEJTAG_OK) {
+        size_t chunk = length < dev->arena ? length : dev->arena;
+
+        ret = FreeJTAG_CtrlIn(dev, FREEJTAG_REQ_BULKBYTE, 0, data, chunk);
+        data += chunk;
+        length -= chunk;
+    }
+    return ret;
+}
+
+int freejtag_avr_read_ocdr(freejtag_t *dev, int16_t *value)
+{
+    uint8_t data[2];
+    int ret;
+
+    ret = FreeJTAG_CtrlIn(dev, FREEJTAG_REQ_READOCDR, 0, data, sizeof(data));
+    if (ret == FREEJTAG_OK) {
+        *value = (int16_t) (data[0] | (data[1] << 8));
+    }
+    return ret;
+}
+
+int freejtag_avr_ocd_regs(freejtag_t *dev, const uint8_t *entries,
+        size_t length, uint8_t *values)
+{
+    const size_t step = dev->arena / 3 * 3;
+    int ret;
+
+    if (length % 3) {
+        return FREEJTAG_ERROR_INVALID;
+    }
+
+    do {
+        size_t chunk = length < step ? length : step;
+        size_t reads = 0;
+
+        for (size_t i = 0; i < chunk; i += 3) {
+            reads += !(entries[i] & (FREEJTAG_OCD_WRITE | FREEJTAG_OCD_EXEC));
+        }
+
+        ret = FreeJTAG_CtrlOut(dev, FREEJTAG_REQ_OCDREGS, 0, entries, chunk);
+        if (ret == FREEJTAG_OK && reads > 0) {
+            ret = FreeJTAG_CtrlIn(dev, FREEJTAG_REQ_READBUF, 0, values,
+                    reads * 2);
+            values += reads * 2;
+        }
+
+        entries += chunk;
+        length -= chunk;
+    } while (length > 0 && ret == FREEJTAG_OK);
+
+    return ret;
+}
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * FreeJTAG
+ * Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FREEJTAG_DEFAULT_VID            0x0403
+#define FREEJTAG_DEFAULT_PID            0x7ba8
+
+/* Arena of firmware that cannot report its own, in bytes */
+#define FREEJTAG_DEFAULT_ARENA          32
+
+/* Register byte flags of an OCD register entry */
+#define FREEJTAG_OCD_WRITE              0x80
+#define FREEJTAG_OCD_EXEC               0x40
+
+typedef enum {
+    FREEJTAG_OK                     = 0,
+    FREEJTAG_ERROR_NOT_FOUND        = -1,
+    FREEJTAG_ERROR_ACCESS           = -2,
+    FREEJTAG_ERROR_IO               = -3,
+    FREEJTAG_ERROR_INVALID          = -4,
+    FREEJTAG_ERROR_NO_MEMORY        = -5,
+} freejtag_error_t;
+
+typedef struct freejtag freejtag_t;
+
+/*
+ * One piece of a scatter/gather scan.  Bits are taken LSB-first starting at
+ * bit tdi_offset of tdi and stored starting at bit tdo_offset of tdo.  A NULL
+ * tdi shifts zeros, a NULL tdo discards the captured bits.
+ */
+typedef struct {
+    const uint8_t *tdi;
+    size_t tdi_offset;
+    uint8_t *tdo;
+    size_t tdo_offset;
+    size_t bits;
+} freejtag_segment_t;
+
+extern int freejtag_open(freejtag_t **dev, uint16_t vid, uint16_t pid,
+        int index, const char *serial);
+extern void freejtag_close(freejtag_t *dev);
+extern const char *freejtag_strerror(int error);
+
+extern int freejtag_version(freejtag_t *dev, uint16_t *version);
+/* Scan buffer size of the probe, scans and bulk transfers are split into
+ * chunks of this many bytes */
+extern size_t freejtag_arena_size(freejtag_t *dev);
+extern int freejtag_reset(freejtag_t *dev);
+extern int freejtag_attach(freejtag_t *dev, bool attach);
+extern int freejtag_set_tdi(freejtag_t *dev, bool value);
+extern int freejtag_set_tms(freejtag_t *dev, bool value);
+extern int freejtag_set_state(freejtag_t *dev, uint8_t state);
+extern int freejtag_clock(freejtag_t *dev, size_t cycles);
+extern int freejtag_set_tck_delay(freejtag_t *dev, uint8_t delay);
+extern int freejtag_shift(freejtag_t *dev, size_t bits, bool exit);
+
+extern int freejtag_scan(freejtag_t *dev, const uint8_t *tdi,
+        size_t tdi_offset, uint8_t *tdo, size_t tdo_offset, size_t bits,
+        bool exit);
+extern int freejtag_scan_sg(freejtag_t *dev,
+        const freejtag_segment_t *segments, size_t count, bool exit);
+
+extern int freejtag_bulk_write(freejtag_t *dev, const uint8_t *data,
+        size_t length);
+extern int freejtag_bulk_read(freejtag_t *dev, uint8_t *data, size_t length);
+
+extern int freejtag_avr_read_ocdr(freejtag_t *dev, int16_t *value);
+/*
+ * Run a list of 3 byte OCD register entries, a register byte then a 16 bit
+ * little endian value.  Each entry without FREEJTAG_OCD_WRITE or
+ * FREEJTAG_OCD_EXEC reads, and the value read goes to the next 2 bytes of
+ * values.  An empty list only checks that the probe supports the request.
+ */
+extern int freejtag_avr_ocd_regs(freejtag_t *dev, const uint8_t *entries,
+        size_t length, uint8_t *values);
+
+extern void freejtag_bitcopy(uint8_t *dst, size_t dst_offset,
+        const uint8_t *src, size_t src_offset, size_t bits);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+#
+# FreeJTAG
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import socket
+from contextlib import contextmanager
+
+from ..daemon import (MSG_BEGIN, MSG_CALLS, MSG_END, MSG_INFO, STATUS_OK,
+        default_socket, frame, parse_frames)
+from ..replay import OPCODES, decode_value, decode_varint, encode_args
+
+
+class Backend:
+    """
+    Client for a probe shared through `pyjtag daemon`.
+
+    Calls without a result are buffered and sent together with the next
+    call that returns one, so a register write followed by a read costs a
+    single round trip and runs atomically on the daemon.
+    """
+
+    def __init__(self, **kwargs):
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            self._sock.connect(kwargs.get('socket') or default_socket())
+        except OSError as e:
+            self._sock.close()
+            raise RuntimeError(f'Cannot connect to pyjtag daemon: {e}')
+        self._rxbuf = bytearray()
+        self._pending = bytearray()
+        self._results = []
+        self.transfers = 0
+        body = self._request(MSG_INFO)
+        limit, pos = decode_varint(body, 0)
+        self.max_scan_bits = limit or None
+        # Older daemons only report the limit
+        if pos < len(body):
+            self.has_ocd_regs = bool(decode_varint(body, pos)[0])
+
+    def _request(self, msg, body=b''):
+        self.transfers += 1
+        self._sock.sendall(frame(bytes((msg,)) + body))
+        while True:
+            for payload in parse_frames(self._rxbuf):
+                if payload[0] != STATUS_OK:
+                    raise RuntimeError(payload[1:].decode())
+                return payload[1:]
+            data = self._sock.recv(65536)
+            if not data:
+                raise RuntimeError('pyjtag daemon closed the connection')
+            self._rxbuf += data
+
+    def _call(self, name, *args):
+        encode_args(name, args, self._pending)
+        result_kind = OPCODES[name][2]
+        if result_kind:
+            self._results.append(result_kind)
+        if name in ('version', 'shift_in', 'shift_outin', 'bulk_read_bytes',
+                'avr_read_ocdr', 'avr_ocd_regs') or (name == 'scan' and args[2]):
+            return self.flush()[-1]
+        if len(self._pending) >= 4096:
+            self.flush()
+
+    def flush(self):
+        if not self._pending:
+            return []
+        body, self._pending = bytes(self._pending), bytearray()
+        kinds, self._results = self._results, []
+        body = self._request(MSG_CALLS, body)
+        results = []
+        pos = 0
+        for kind in kinds:
+            result, pos = decode_value(kind, body, pos)
+            results.append(result)
+        return results
+
+    @contextmanager
+    def transaction(self):
+        self.flush()
+        self._request(MSG_BEGIN)
+        try:
+            yield
+        finally:
+            try:
+                self.flush()
+            finally:
+                self._request(MSG_END)
+
+    def close(self):
+        if self._sock.fileno() >= 0:
+            try:
+                self.flush()
+            finally:
+                self._sock.close()
+
+    def _acquire(self):
+        pass
+
+    def _release(self):
+        self.flush()
+
+    def version(self):
+        return self._call('version')
+
+    def set_tdi(self, value=True):
+        self._call('set_tdi', value)
+
+    def set_tms(self, value=True):
+        self._call('set_tms', value)
+
+    def set_state(self, state):
+        self._call('set_state', state)
+
+    def clock(self, cycles):
+        self._call('clock', cycles)
+
+    def set_tck_delay(self, delay):
+        self._call('set_tck_delay', delay)
+
+    def shift(self, bits, exit=True):
+        self._call('shift', bits, exit)
+
+    def shift_out(self, bits, value: int, exit=True):
+        self._call('shift_out', bits, value, exit)
+
+    def shift_in(self, bits, exit=True):
+        return self._call('shift_in', bits, exit)
+
+    def shift_outin(self, bits, value, exit=True):
+        return self._call('shift_outin', bits, value, exit)
+
+    def scan(self, bits, tdi=None, tdo=None, exit=True):
+        n_bytes = (bits + 7) // 8
+        tdi = bytes(tdi[:n_bytes]) if tdi is not None else None
+        data = self._call('scan', bits, tdi,
+                True if tdo is not None else None, exit)
+        if tdo is not None:
+            tdo[:n_bytes] = data
+
+    def bulk_write_bytes(self, data: bytes) -> None:
+        self._call('bulk_write_bytes', bytes(data))
+
+    def bulk_read_bytes(self, count: int) -> bytes:
+        return self._call('bulk_read_bytes', count)
+
+    def avr_read_ocdr(self):
+        return self._call('avr_read_ocdr')
+
+    def avr_ocd_regs(self, data: bytes) -> bytes:
+        return self._call('avr_ocd_regs', bytes(data))
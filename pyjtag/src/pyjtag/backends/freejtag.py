@@ -9,7 +9,7 @@ from sys import stderr
 import usb.core
 import usb.util
 
-from ..jtag import JTAG
+from ..jtag import JTAG, OCD_REG_WRITE, OCD_REG_EXEC
 
 class Backend:
     REQ_VERSION             = 0x00
@@ -17,7 +17,12 @@ class Backend:
     REQ_EXECUTE             = 0x02
     REQ_READBUF             = 0x03
     REQ_BULKBYTE            = 0x04
+    REQ_ARENA               = 0x05
     REQ_READOCDR            = 0x80
+    REQ_XSVF                = 0x81
+    REQ_OCDREGS             = 0x82
+
+    XSVF_FLAG_START         = 0x01
 
     CMD_NOP                 = 0x00
     CMD_ATTACH              = 0x01
@@ -27,6 +32,7 @@ class Backend:
     CMD_CLOCK               = 0x05
     CMD_SHIFT               = 0x06
     CMD_SHIFT_EXIT          = 0x07
+    CMD_SET_DELAY           = 0x08
     CMD_SHIFT_OUT           = 0x40
     CMD_SHIFT_OUT_EXIT      = 0x41
     CMD_SHIFT_IN            = 0x80
@@ -34,6 +40,15 @@ class Backend:
     CMD_SHIFT_OUTIN         = 0xC0
     CMD_SHIFT_OUTIN_EXIT    = 0xC1
 
+    # Until the probe reports its arena, assume the original 32 byte buffers
+    arena_size              = 32
+    max_scan_bits           = 256
+    # Firmware without the arena has its own 32 byte XSVF vectors, 0 when
+    # the probe has no XSVF player at all
+    xsvf_max_bits           = 256
+    # Cleared when the probe stalls the OCD registers request
+    has_ocd_regs            = True
+
     def __init__(self, **kwargs):
         index = kwargs.get('index') or 0
 
@@ -41,19 +56,38 @@ class Backend:
         try:
             self._device = devices[index]
         except IndexError:
+            if kwargs.get('serial') is not None:
+                raise RuntimeError('Invalid FreeJTAG device serial')
             raise RuntimeError('Invalid FreeJTAG device index')
         self._config = self._device.get_active_configuration()
         self._intf = self.get_freejtag_intf(self._device)
+        self._bmRequestType_out = usb.util.build_request_type(
+            usb.util.CTRL_OUT,
+            usb.util.CTRL_TYPE_VENDOR,
+            usb.util.CTRL_RECIPIENT_INTERFACE)
+        self._bmRequestType_in = usb.util.build_request_type(
+            usb.util.CTRL_IN,
+            usb.util.CTRL_TYPE_VENDOR,
+            usb.util.CTRL_RECIPIENT_INTERFACE)
+        self.transfers = 0
 
     @classmethod
     def get_devices(cls, **kwargs):
         vid = kwargs.get('vid') or 0x0403
         pid = kwargs.get('pid') or 0x7ba8
+        serial = kwargs.get('serial')
         devices = usb.core.find(idVendor=vid, idProduct=pid, find_all=True)
         if not devices:
             raise RuntimeError('No devices found')
 
-        return tuple(filter(cls.get_freejtag_intf, devices))
+        devices = filter(cls.get_freejtag_intf, devices)
+        if serial is not None:
+            devices = filter(lambda d: cls.get_sn(d) == serial, devices)
+        return tuple(devices)
+
+    @classmethod
+    def get_serials(cls, **kwargs):
+        return tuple(cls.get_sn(device) for device in cls.get_devices(**kwargs))
 
     @classmethod
     def get_freejtag_intf(cls, device):
@@ -107,18 +141,55 @@ class Backend:
     def _acquire(self):
         usb.util.claim_interface(self._device, self._intf)
         self._attach(True)
+        self._query_arena()
+        self._query_xsvf()
+        self._query_ocd_regs()
+
+    def _query_arena(self):
+        try:
+            data = self._ctrl_in(self.REQ_ARENA, 0, 2)
+        except (usb.core.USBError, RuntimeError):
+            # Older firmware stalls the request
+            return
+        self.arena_size = int.from_bytes(data, 'little')
+        self.max_scan_bits = self.arena_size * 8
+        # XSVF keeps each vector in a quarter of the arena
+        self.xsvf_max_bits = self.max_scan_bits // 4
+
+    def _query_xsvf(self):
+        try:
+            self.xsvf_status()
+        except (usb.core.USBError, RuntimeError):
+            # MINI_FREEJTAG and older firmware have no player, files are
+            # played from the host instead
+            self.xsvf_max_bits = 0
+
+    def _query_ocd_regs(self):
+        try:
+            # An empty entry list runs nothing
+            self._ctrl_out(self.REQ_OCDREGS, 0, b'')
+        except (usb.core.USBError, RuntimeError):
+            # MINI_FREEJTAG and older firmware stall the request, JTAG
+            # falls back to single register reads and writes
+            self.has_ocd_regs = False
 
     def _release(self):
         self._attach(False)
         usb.util.release_interface(self._device, self._intf)
 
+    def _ctrl_out(self, bRequest, wValue=0, data=None, timeout=None,
+            length_hi=0):
+        self.transfers += 1
+        self._device.ctrl_transfer(self._bmRequestType_out, bRequest, wValue,
+                (length_hi << 8) | self._intf.bInterfaceNumber, data, timeout)
+
+    def _ctrl_in(self, bRequest, wValue, wLength):
+        self.transfers += 1
+        return self._device.ctrl_transfer(self._bmRequestType_in, bRequest,
+                wValue, self._intf.bInterfaceNumber, wLength)
+
     def version(self):
-        bmRequestType = usb.util.build_request_type(
-            usb.util.CTRL_IN,
-            usb.util.CTRL_TYPE_VENDOR,
-            usb.util.CTRL_RECIPIENT_INTERFACE)
-        data = self._device.ctrl_transfer(bmRequestType, self.REQ_VERSION, 0,
-                self._intf.bInterfaceNumber, 2)
+        data = self._ctrl_in(self.REQ_VERSION, 0, 2)
         value = int.from_bytes(data, 'little')
         major = (value & 0xFF00) >> 8
         minor = (value & 0xF0) >> 4
@@ -126,21 +197,12 @@ class Backend:
         return major, minor, patch
 
     def _execute(self, cmd, arg, data=None):
-        bmRequestType = usb.util.build_request_type(
-            usb.util.CTRL_OUT,
-            usb.util.CTRL_TYPE_VENDOR,
-            usb.util.CTRL_RECIPIENT_INTERFACE)
-        wValue = (arg << 8) | (cmd & 0xff)
-        self._device.ctrl_transfer(bmRequestType, self.REQ_EXECUTE, wValue,
-                self._intf.bInterfaceNumber, data)
+        # Shift lengths past 256 bits carry their high byte in wIndex
+        wValue = ((arg & 0xff) << 8) | (cmd & 0xff)
+        self._ctrl_out(self.REQ_EXECUTE, wValue, data, length_hi=arg >> 8)
 
     def _readbuf(self, wLength):
-        bmRequestType = usb.util.build_request_type(
-            usb.util.CTRL_IN,
-            usb.util.CTRL_TYPE_VENDOR,
-            usb.util.CTRL_RECIPIENT_INTERFACE)
-        return self._device.ctrl_transfer(bmRequestType, self.REQ_READBUF, 0,
-                self._intf.bInterfaceNumber, wLength)
+        return self._ctrl_in(self.REQ_READBUF, 0, wLength)
 
     def _attach(self, attach=True):
         self._execute(self.CMD_ATTACH, attach)
@@ -149,7 +211,7 @@ class Backend:
         self._execute(self.CMD_SET_TDI, value)
 
     def set_tms(self, value=True):
-        self._execute(self.CMD_SET_MS, value)
+        self._execute(self.CMD_SET_TMS, value)
 
     def set_state(self, state):
         self._execute(self.CMD_SET_STATE, state)
@@ -158,6 +220,9 @@ class Backend:
     def clock(self, cycles):
         self._execute(self.CMD_CLOCK, cycles - 1)
 
+    def set_tck_delay(self, delay):
+        self._execute(self.CMD_SET_DELAY, delay)
+
     def shift(self, bits, exit=True):
         cmd = self.CMD_SHIFT_EXIT if exit else self.CMD_SHIFT
         self._execute(cmd, bits - 1)
@@ -183,39 +248,64 @@ class Backend:
         data = self._readbuf(n_bytes)
         return int.from_bytes(data, 'little') & ((1 << bits) - 1)
 
+    def scan(self, bits, tdi=None, tdo=None, exit=True):
+        if not 0 < bits <= self.max_scan_bits:
+            raise ValueError('Invalid scan length')
+        n_bytes = (bits + 7) // 8
+        if tdi is not None and tdo is not None:
+            cmd = self.CMD_SHIFT_OUTIN
+        elif tdi is not None:
+            cmd = self.CMD_SHIFT_OUT
+        elif tdo is not None:
+            cmd = self.CMD_SHIFT_IN
+        else:
+            cmd = self.CMD_SHIFT
+        cmd |= bool(exit)
+        self._execute(cmd, bits - 1, tdi[:n_bytes] if tdi is not None else None)
+        if tdo is not None:
+            tdo[:n_bytes] = self._readbuf(n_bytes)
+
     def bulk_write_bytes(self, data: bytes) -> None:
-        bmRequestType = usb.util.build_request_type(
-            usb.util.CTRL_OUT,
-            usb.util.CTRL_TYPE_VENDOR,
-            usb.util.CTRL_RECIPIENT_INTERFACE)
         while True:
-            chunk, data = data[:32], data[32:]
+            chunk, data = data[:self.arena_size], data[self.arena_size:]
             if not chunk:
                 break
-            self._device.ctrl_transfer(bmRequestType, self.REQ_BULKBYTE, 0,
-                    self._intf.bInterfaceNumber, chunk)
+            self._ctrl_out(self.REQ_BULKBYTE, 0, chunk)
 
     def bulk_read_bytes(self, count: int) -> bytes:
-        bmRequestType = usb.util.build_request_type(
-            usb.util.CTRL_IN,
-            usb.util.CTRL_TYPE_VENDOR,
-            usb.util.CTRL_RECIPIENT_INTERFACE)
         data = b''
         while count > 0:
-            chunk = min(32, count)
-            data += self._device.ctrl_transfer(bmRequestType, self.REQ_BULKBYTE, 0,
-                    self._intf.bInterfaceNumber, chunk)
+            chunk = min(self.arena_size, count)
+            data += self._ctrl_in(self.REQ_BULKBYTE, 0, chunk)
             count -= chunk
         return data
 
     def avr_read_ocdr(self):
-        bmRequestType = usb.util.build_request_type(
-            usb.util.CTRL_IN,
-            usb.util.CTRL_TYPE_VENDOR,
-            usb.util.CTRL_RECIPIENT_INTERFACE)
-        data = self._device.ctrl_transfer(bmRequestType, self.REQ_READOCDR, 0,
-                self._intf.bInterfaceNumber, 2)
+        data = self._ctrl_in(self.REQ_READOCDR, 0, 2)
         ch = int.from_bytes(data, 'little', signed=True)
         if ch < 0:
             return None
         return bytes((ch,))
+
+    def avr_ocd_regs(self, data: bytes) -> bytes:
+        # 3 byte entries, as many as fit the arena per transfer
+        step = self.arena_size // 3 * 3
+        result = b''
+        for pos in range(0, len(data), step):
+            chunk = data[pos:pos + step]
+            self._ctrl_out(self.REQ_OCDREGS, 0, chunk)
+            reads = sum(not reg & (OCD_REG_WRITE | OCD_REG_EXEC)
+                    for reg in chunk[::3])
+            if reads:
+                result += self._readbuf(reads * 2)
+        return result
+
+    def xsvf_write(self, data: bytes, start=False) -> None:
+        # The firmware plays the data before completing the transfer, and
+        # XRUNTEST/XWAIT can stretch that into seconds
+        self._ctrl_out(self.REQ_XSVF, self.XSVF_FLAG_START if start else 0,
+                data, timeout=60000)
+
+    def xsvf_status(self):
+        data = self._ctrl_in(self.REQ_XSVF, 0, 6)
+        return data[0], data[1], int.from_bytes(data[2:6], 'little')
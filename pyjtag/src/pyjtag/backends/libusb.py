@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+#
+# FreeJTAG
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import re
+from collections import deque
+
+import usb1
+
+from .freejtag import Backend as FreeJTAGBackend
+
+
+class Pending:
+    def __init__(self, backend, transfer, convert=None):
+        self._backend = backend
+        self._transfer = transfer
+        self._convert = convert
+        self._value = None
+        self.done = False
+
+    def _complete(self, data):
+        self._value = data if self._convert is None else self._convert(data)
+        self.done = True
+
+    def result(self):
+        if not self.done:
+            self._backend._wait(self._transfer)
+            if not self.done:
+                raise RuntimeError('Control transfer failed')
+        return self._value
+
+
+class Backend(FreeJTAGBackend):
+    REQTYPE_OUT = usb1.TYPE_VENDOR | usb1.RECIPIENT_INTERFACE | \
+            usb1.ENDPOINT_OUT
+    REQTYPE_IN = usb1.TYPE_VENDOR | usb1.RECIPIENT_INTERFACE | \
+            usb1.ENDPOINT_IN
+
+    TIMEOUT = 1000
+
+    def __init__(self, **kwargs):
+        index = kwargs.get('index') or 0
+        depth = kwargs.get('depth') or 8
+
+        self._context = usb1.USBContext()
+        self._context.open()
+        try:
+            devices = self.get_devices(context=self._context, **kwargs)
+            try:
+                self._device, self._ifnum = devices[index]
+            except IndexError:
+                raise RuntimeError('Invalid FreeJTAG device index')
+            self._handle = self._device.open()
+        except Exception:
+            self._context.close()
+            raise
+
+        self._free = deque(self._handle.getTransfer() for _ in range(depth))
+        self._inflight = deque()
+        self._pending = {}
+        self._error = None
+        self.transfers = 0
+
+    @classmethod
+    def get_devices(cls, context, **kwargs):
+        # The devices are only usable while the caller keeps context open
+        vid = kwargs.get('vid') or 0x0403
+        pid = kwargs.get('pid') or 0x7ba8
+        serial = kwargs.get('serial')
+
+        devices = []
+        for device in context.getDeviceIterator(skip_on_error=True):
+            if device.getVendorID() != vid or device.getProductID() != pid:
+                continue
+            try:
+                handle = device.open()
+            except usb1.USBError:
+                raise Exception('Error accessing device, check permissions')
+            try:
+                if serial is not None and \
+                        handle.getSerialNumber() != serial:
+                    continue
+                ifnum = cls.get_freejtag_ifnum(device, handle)
+            finally:
+                handle.close()
+            if ifnum is not None:
+                devices.append((device, ifnum))
+        if not devices:
+            raise RuntimeError('No devices found')
+        return tuple(devices)
+
+    @classmethod
+    def get_serials(cls, **kwargs):
+        serials = []
+        with usb1.USBContext() as context:
+            for device, _ in cls.get_devices(context, **kwargs):
+                handle = device.open()
+                try:
+                    serials.append(handle.getSerialNumber())
+                finally:
+                    handle.close()
+        return tuple(serials)
+
+    @staticmethod
+    def get_freejtag_ifnum(device, handle):
+        for setting in device.iterSettings():
+            index = setting.getDescriptor()
+            if not index:
+                continue
+            string = handle.getASCIIStringDescriptor(index)
+            if string and re.search(r'^FreeJTAG Interface$', string):
+                return setting.getNumber()
+        return None
+
+    def _acquire(self):
+        self._handle.claimInterface(self._ifnum)
+        self._attach(True)
+        self._query_arena()
+        self._query_xsvf()
+        self._query_ocd_regs()
+
+    def _query_ocd_regs(self):
+        # A stall only shows once the transfer completes, so wait for it
+        # rather than letting the next read raise it
+        self.flush()
+        try:
+            self._ctrl_out(self.REQ_OCDREGS, 0, b'')
+            self.flush()
+        except RuntimeError:
+            self.has_ocd_regs = False
+
+    def _release(self):
+        try:
+            self._attach(False)
+            self.flush()
+        finally:
+            self._handle.releaseInterface(self._ifnum)
+
+    def _on_complete(self, transfer):
+        pending = self._pending.pop(id(transfer), None)
+        status = transfer.getStatus()
+        if status != usb1.TRANSFER_COMPLETED:
+            self._error = self._error or RuntimeError(
+                    f'Control transfer failed with status {status}')
+        elif pending is not None:
+            length = transfer.getActualLength()
+            pending._complete(bytes(transfer.getBuffer()[:length]))
+
+    def _reap(self):
+        while self._inflight and not self._inflight[0].isSubmitted():
+            self._free.append(self._inflight.popleft())
+
+    def _wait(self, transfer=None):
+        while self._inflight:
+            if transfer is not None and not transfer.isSubmitted():
+                break
+            self._context.handleEventsTimeout(self.TIMEOUT / 1000)
+            self._reap()
+        self._reap()
+        if self._error is not None:
+            error, self._error = self._error, None
+            raise error
+
+    def _submit(self, bRequestType, bRequest, wValue, data, timeout=None,
+            length_hi=0):
+        while not self._free:
+            self._wait(self._inflight[0])
+        transfer = self._free.popleft()
+        transfer.setControl(bRequestType, bRequest, wValue,
+                (length_hi << 8) | self._ifnum,
+                data, callback=self._on_complete,
+                timeout=timeout or self.TIMEOUT)
+        transfer.submit()
+        self._inflight.append(transfer)
+        self.transfers += 1
+        return transfer
+
+    def _ctrl_out(self, bRequest, wValue=0, data=None, timeout=None,
+            length_hi=0):
+        self._submit(self.REQTYPE_OUT, bRequest, wValue, bytes(data or b''),
+                timeout, length_hi)
+
+    def _ctrl_in_deferred(self, bRequest, wValue, wLength, convert=None):
+        transfer = self._submit(self.REQTYPE_IN, bRequest, wValue, wLength)
+        pending = Pending(self, transfer, convert)
+        self._pending[id(transfer)] = pending
+        return pending
+
+    def _ctrl_in(self, bRequest, wValue, wLength):
+        return self._ctrl_in_deferred(bRequest, wValue, wLength).result()
+
+    def flush(self):
+        self._wait()
+
+    def shift_in_deferred(self, bits, exit=True):
+        cmd = self.CMD_SHIFT_IN_EXIT if exit else self.CMD_SHIFT_IN
+        n_bytes = (bits + 7) // 8
+        self._execute(cmd, bits - 1)
+        return self._ctrl_in_deferred(self.REQ_READBUF, 0, n_bytes,
+                lambda data: int.from_bytes(data, 'little') &
+                        ((1 << bits) - 1))
+
+    def shift_outin_deferred(self, bits, value, exit=True):
+        cmd = self.CMD_SHIFT_OUTIN_EXIT if exit else self.CMD_SHIFT_OUTIN
+        n_bytes = (bits + 7) // 8
+        self._execute(cmd, bits - 1, value.to_bytes(n_bytes, 'little'))
+        return self._ctrl_in_deferred(self.REQ_READBUF, 0, n_bytes,
+                lambda data: int.from_bytes(data, 'little') &
+                        ((1 << bits) - 1))
+
+    def bulk_read_bytes(self, count: int) -> bytes:
+        chunks = []
+        while count > 0:
+            chunk = min(self.arena_size, count)
+            chunks.append(self._ctrl_in_deferred(self.REQ_BULKBYTE, 0, chunk))
+            count -= chunk
+        return b''.join(chunk.result() for chunk in chunks)
+
+    def close(self):
+        self._wait()
+        for transfer in self._free:
+            transfer.close()
+        self._free.clear()
+        self._handle.close()
+        self._context.close()
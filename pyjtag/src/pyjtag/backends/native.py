@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+#
+# FreeJTAG
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+from ..libfreejtag import Device, FreeJTAGError
+
+
+class Backend:
+    has_ocd_regs = True
+
+    def __init__(self, **kwargs):
+        self._device = Device(
+            vid=kwargs.get('vid') or 0x0403,
+            pid=kwargs.get('pid') or 0x7ba8,
+            index=kwargs.get('index') or 0,
+            serial=kwargs.get('serial'))
+        # libfreejtag splits longer scans itself, but callers that plan
+        # their own chunks should size them to the probe
+        self.arena_size = self._device.arena_size()
+        self.max_scan_bits = self.arena_size * 8
+
+    def _acquire(self):
+        self._attach(True)
+        self._query_ocd_regs()
+
+    def _query_ocd_regs(self):
+        try:
+            # An empty entry list runs nothing
+            self._device.avr_ocd_regs(b'')
+        except FreeJTAGError:
+            # MINI_FREEJTAG and older firmware stall the request, JTAG
+            # falls back to single register reads and writes
+            self.has_ocd_regs = False
+
+    def _release(self):
+        self._attach(False)
+
+    def _attach(self, attach=True):
+        self._device.attach(attach)
+
+    def close(self):
+        # Frees the USB context now rather than whenever the device is
+        # garbage collected
+        self._device.close()
+
+    def version(self):
+        value = self._device.version()
+        major = (value & 0xFF00) >> 8
+        minor = (value & 0xF0) >> 4
+        patch = (value & 0xF)
+        return major, minor, patch
+
+    def set_tdi(self, value=True):
+        self._device.set_tdi(value)
+
+    def set_tms(self, value=True):
+        self._device.set_tms(value)
+
+    def set_state(self, state):
+        self._device.set_state(state)
+
+    def clock(self, cycles):
+        self._device.clock(cycles)
+
+    def set_tck_delay(self, delay):
+        self._device.set_tck_delay(delay)
+
+    def shift(self, bits, exit=True):
+        self._device.shift(bits, exit)
+
+    def scan(self, bits, tdi=None, tdo=None, exit=True, tdi_offset=0,
+            tdo_offset=0):
+        self._device.scan(bits, tdi, tdo, exit, tdi_offset, tdo_offset)
+
+    def scan_sg(self, segments, exit=True):
+        self._device.scan_sg(segments, exit)
+
+    def shift_out(self, bits, value: int, exit=True):
+        n_bytes = (bits + 7) // 8
+        self._device.scan(bits, value.to_bytes(n_bytes, 'little'), None, exit)
+
+    def shift_in(self, bits, exit=True):
+        data = bytearray((bits + 7) // 8)
+        self._device.scan(bits, None, data, exit)
+        return int.from_bytes(data, 'little') & ((1 << bits) - 1)
+
+    def shift_outin(self, bits, value, exit=True):
+        n_bytes = (bits + 7) // 8
+        data = bytearray(value.to_bytes(n_bytes, 'little'))
+        self._device.scan(bits, data, data, exit)
+        return int.from_bytes(data, 'little') & ((1 << bits) - 1)
+
+    def bulk_write_bytes(self, data: bytes) -> None:
+        self._device.bulk_write(data)
+
+    def bulk_read_bytes(self, count: int) -> bytes:
+        data = bytearray(count)
+        self._device.bulk_read_into(data)
+        return bytes(data)
+
+    def avr_read_ocdr(self):
+        ch = self._device.avr_read_ocdr()
+        if ch < 0:
+            return None
+        return bytes((ch,))
+
+    def avr_ocd_regs(self, data: bytes) -> bytes:
+        # libfreejtag splits the list to fit the arena
+        return self._device.avr_ocd_regs(data)
@@ -0,0 +1,506 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+#
+# FreeJTAG
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+from collections import deque
+
+from ..jtag import (JTAG, OCD_REG_WRITE, OCD_REG_EXEC, IR_IDCODE, AVR_IR_PROG_ENABLE, AVR_IR_PROG_COMMANDS,
+        AVR_IR_PRIVATE0, AVR_IR_PRIVATE1, AVR_IR_PRIVATE2, AVR_IR_PRIVATE3,
+        AVR_IR_RESET, AVR_IR_BYPASS)
+from ..bscan import BSDL, SAMPLE_NAMES
+from ..ocd import (OCD_BCR, OCD_PSB0, OCD_PSB1, BCR_PSB0, BCR_PSB1, BCR_STEP,
+        CSR_STOPPED)
+from ..tap import TAP_NEXT, set_state_supported, tap_path
+
+
+class Register:
+    def __init__(self, length=None, value=0):
+        self.length = length
+        self.value = value
+        self._sr = 0
+        self._count = 0
+
+    def capture(self):
+        self._sr = self.value
+        self._count = 0
+
+    def shift(self, tdi):
+        tdo = self._sr & 1
+        if self.length:
+            self._sr = (self._sr >> 1) | (tdi << (self.length - 1))
+        else:
+            self._sr = (self._sr >> 1) | (tdi << 64)
+        self._count += 1
+        return tdo
+
+    def update(self):
+        if self.length:
+            return self._sr, self.length
+        shifted = self._sr >> max(65 - self._count, 0)
+        return shifted & ((1 << self._count) - 1), self._count
+
+
+class AVRCore:
+    """
+    Just enough of an AVR to exercise the OCD instruction interface: a
+    flat data space with the register file at 0, and the few instructions
+    the debugger executes.  Nothing runs on its own.
+    """
+
+    def __init__(self, ocdr_io=0x31, flash_size=0x8000, sram_end=0x860):
+        self.ocdr_io = ocdr_io
+        self.data = bytearray(sram_end)
+        self.flash = bytearray(b'\xff' * flash_size)
+        self.pc = 0
+        self.halted = False
+
+    def _z(self):
+        return self.data[30] | (self.data[31] << 8)
+
+    def _z_inc(self):
+        z = self._z()
+        self.data[30] = (z + 1) & 0xFF
+        self.data[31] = ((z + 1) >> 8) & 0xFF
+        return z
+
+    def execute(self, insn, ocdr):
+        d = (insn >> 4) & 0x1F
+        io = ((insn >> 5) & 0x30) | (insn & 0xF)
+        if insn & 0xF800 == 0xB800:
+            if io == self.ocdr_io:
+                ocdr(self.data[d])
+            else:
+                self.data[0x20 + io] = self.data[d]
+        elif insn & 0xF800 == 0xB000:
+            self.data[d] = self.data[0x20 + io]
+        elif insn & 0xF000 == 0xE000:
+            self.data[16 + (d & 0xF)] = ((insn >> 4) & 0xF0) | (insn & 0xF)
+        elif insn & 0xFC00 == 0x2C00:
+            self.data[d] = self.data[((insn >> 5) & 0x10) | (insn & 0xF)]
+        elif insn & 0xFE0F == 0x9001:
+            self.data[d] = self.data[self._z_inc() % len(self.data)]
+        elif insn & 0xFE0F == 0x9201:
+            self.data[self._z_inc() % len(self.data)] = self.data[d]
+        elif insn & 0xFE0F == 0x9005:
+            self.data[d] = self.flash[self._z_inc() % len(self.flash)]
+        elif insn == 0x9409:
+            self.pc = self._z()
+
+
+class BoundaryRegister(Register):
+    """
+    Boundary cells described by a BSDL file.  Pads read back what EXTEST
+    drives on them, otherwise the level in `pads` (default high, as if
+    pulled up).
+    """
+
+    def __init__(self, bsdl):
+        super().__init__(bsdl.length)
+        self.bsdl = bsdl
+        self.latch = 0
+        self.pads = {}
+        self.driving = False
+
+    def pad(self, pin):
+        if self.driving and pin.output is not None:
+            enabled = pin.control is None or \
+                    (self.latch >> pin.control) & 1 != pin.disable
+            if enabled:
+                return (self.latch >> pin.output) & 1
+        return self.pads.get(pin.name, 1)
+
+    def capture(self):
+        self.value = self.latch
+        for pin in self.bsdl.pins.values():
+            if pin.input is not None:
+                self.value &= ~(1 << pin.input)
+                self.value |= self.pad(pin) << pin.input
+        super().capture()
+
+    def update(self):
+        value, bits = super().update()
+        self.latch = value
+        return value, bits
+
+
+class AVRTarget:
+    IR_LENGTH = 4
+
+    def __init__(self, idcode=0x8950203F, signature=b'\x1e\x95\x02',
+            console=b'', bsdl=None):
+        self.signature = bytes(signature)
+        self.console = deque(console)
+        self.ocd = [0] * 16
+        self.reset_held = 0
+        self.prog_enabled = False
+        self._prog_addr = 0
+        self._prog_out = 0
+        self.ir = Register(self.IR_LENGTH, IR_IDCODE)
+        self.core = AVRCore()
+        self.registers = {
+            IR_IDCODE:              Register(32, idcode),
+            AVR_IR_BYPASS:          Register(1),
+            AVR_IR_RESET:           Register(1),
+            AVR_IR_PROG_ENABLE:     Register(16),
+            AVR_IR_PROG_COMMANDS:   Register(15),
+            AVR_IR_PRIVATE2:        Register(16),
+            AVR_IR_PRIVATE3:        Register(),
+        }
+        self._ocd_addr = 0
+        self.instruction = IR_IDCODE
+        self.boundary = None
+        self._extest = None
+        if bsdl is not None:
+            self.boundary = BoundaryRegister(bsdl)
+            self._extest = bsdl.opcodes.get('EXTEST')
+            for name in ('EXTEST',) + SAMPLE_NAMES:
+                if name in bsdl.opcodes:
+                    self.registers[bsdl.opcodes[name]] = self.boundary
+
+    def reset(self):
+        self.instruction = IR_IDCODE
+        if self.boundary is not None:
+            self.boundary.driving = False
+
+    def data_register(self):
+        return self.registers.get(self.instruction,
+                self.registers[AVR_IR_BYPASS])
+
+    def capture_ir(self):
+        self.ir.value = 0b0001
+        self.ir.capture()
+
+    def update_ir(self):
+        value, _ = self.ir.update()
+        self.instruction = value
+        if self.boundary is not None:
+            self.boundary.driving = value == self._extest
+        if value == AVR_IR_PRIVATE0:
+            self.core.halted = True
+        elif value == AVR_IR_PRIVATE1:
+            self.run()
+
+    def run(self):
+        # There is no program, so a step advances one word and an armed
+        # breakpoint is reached immediately.
+        bcr = self.ocd[OCD_BCR]
+        self.core.halted = True
+        if bcr & BCR_STEP:
+            self.core.pc += 1
+        elif bcr & BCR_PSB0:
+            self.core.pc = self.ocd[OCD_PSB0]
+        elif bcr & BCR_PSB1:
+            self.core.pc = self.ocd[OCD_PSB1]
+        else:
+            self.core.halted = False
+
+    def _ocdr_write(self, value):
+        self.console.appendleft(value)
+
+    def capture_dr(self):
+        reg = self.data_register()
+        if self.instruction == AVR_IR_PRIVATE3:
+            if self._ocd_addr == 0xD and self.console:
+                self.ocd[0xD] |= 0x10
+            elif self._ocd_addr == 0xD:
+                self.ocd[0xD] &= ~0x10
+            if self._ocd_addr == 0xD and self.core.halted:
+                self.ocd[0xD] |= CSR_STOPPED
+            elif self._ocd_addr == 0xD:
+                self.ocd[0xD] &= ~CSR_STOPPED
+            if self._ocd_addr == 0xC and self.console:
+                self.ocd[0xC] = self.console[0] << 8
+            reg.value = self.ocd[self._ocd_addr]
+        elif self.instruction == AVR_IR_PROG_COMMANDS:
+            reg.value = self._prog_out
+        elif self.instruction == AVR_IR_PRIVATE2:
+            reg.value = self.core.pc
+        elif self.instruction == AVR_IR_BYPASS or reg is \
+                self.registers[AVR_IR_BYPASS]:
+            reg.value = 0
+        reg.capture()
+
+    def update_dr(self):
+        reg = self.data_register()
+        value, bits = reg.update()
+        if self.instruction == AVR_IR_RESET:
+            self.reset_held = value & 1
+        elif self.instruction == AVR_IR_PROG_ENABLE:
+            self.prog_enabled = value == 0xA370
+        elif self.instruction == AVR_IR_PROG_COMMANDS:
+            command = value >> 8
+            if command == 0b0000011:
+                self._prog_addr = value & 0xFF
+            elif command == 0b0110010 and self.prog_enabled and \
+                    self._prog_addr < len(self.signature):
+                self._prog_out = self.signature[self._prog_addr]
+        elif self.instruction == AVR_IR_PRIVATE2:
+            if self.core.halted:
+                self.core.execute(value, self._ocdr_write)
+        elif self.instruction == AVR_IR_PRIVATE3:
+            if bits == 5:
+                self._ocd_addr = value & 0xF
+            elif bits == 16 and self._ocd_addr == 0xC and self.console:
+                self.console.popleft()
+            elif bits == 21 and value & (1 << 20):
+                self.ocd[(value >> 16) & 0xF] = value & 0xFFFF
+
+
+class TAP:
+    def __init__(self, target):
+        self.target = target
+        self.state = JTAG.STATE_RESET
+
+    def clock(self, tms, tdi):
+        state = self.state
+        tdo = 1
+        if state == JTAG.STATE_DRSHIFT:
+            tdo = self.target.data_register().shift(tdi)
+        elif state == JTAG.STATE_IRSHIFT:
+            tdo = self.target.ir.shift(tdi)
+
+        self.state = TAP_NEXT[state][tms]
+        if self.state == JTAG.STATE_RESET:
+            self.target.reset()
+        elif self.state == JTAG.STATE_DRCAPTURE:
+            self.target.capture_dr()
+        elif self.state == JTAG.STATE_IRCAPTURE:
+            self.target.capture_ir()
+        elif self.state == JTAG.STATE_DRUPDATE:
+            self.target.update_dr()
+        elif self.state == JTAG.STATE_IRUPDATE:
+            self.target.update_ir()
+        return tdo
+
+
+class Backend:
+    # Mirrors the firmware's 256 byte scan arena
+    arena_size = 256
+    max_scan_bits = arena_size * 8
+
+    def __init__(self, **kwargs):
+        index = kwargs.get('index') or 0
+        serial = kwargs.get('serial')
+
+        serials = self.get_devices(**kwargs)
+        if serial is not None:
+            if serial not in serials:
+                raise RuntimeError('Invalid FreeJTAG device serial')
+        else:
+            try:
+                serial = serials[index]
+            except IndexError:
+                raise RuntimeError('Invalid FreeJTAG device index')
+        self.serial = serial
+
+        target_args = {}
+        for name in ('idcode', 'signature', 'console', 'bsdl'):
+            if kwargs.get(name) is not None:
+                target_args[name] = kwargs[name]
+        if isinstance(target_args.get('signature'), str):
+            target_args['signature'] = bytes.fromhex(target_args['signature'])
+        if isinstance(target_args.get('console'), str):
+            target_args['console'] = target_args['console'].encode()
+        if isinstance(target_args.get('bsdl'), str):
+            target_args['bsdl'] = BSDL.load(target_args['bsdl'])
+        self.target = AVRTarget(**target_args)
+        self.tap = TAP(self.target)
+        self.transfers = 0
+        self._tms = 0
+        self._tdi = 0
+        self._state = JTAG.STATE_UNKNOWN
+        # A marginal target: below min_tck_delay TDO is sampled a bit late
+        self.min_tck_delay = int(kwargs.get('min_tck_delay') or 0)
+        self.tck_delay = 0
+        self._tdo = 0
+        # Mirrors the firmware's IR shadow for avr_read_ocdr
+        self._ir = None
+
+    @classmethod
+    def get_devices(cls, **kwargs):
+        count = int(kwargs.get('count') or 1)
+        return tuple(f'SIM{i}' for i in range(count))
+
+    @classmethod
+    def get_serials(cls, **kwargs):
+        return cls.get_devices(**kwargs)
+
+    def _clock(self):
+        tdo = self.tap.clock(self._tms, self._tdi)
+        if self.tck_delay < self.min_tck_delay:
+            tdo, self._tdo = self._tdo, tdo
+        return tdo
+
+    def _acquire(self):
+        self._attach(True)
+
+    def _release(self):
+        self._attach(False)
+
+    def _attach(self, attach=True):
+        self.transfers += 1
+        if attach:
+            self._tms = 1
+            self._tdi = 0
+            for _ in range(1024):
+                self._clock()
+            self._state = JTAG.STATE_RESET
+            self._ir = None
+
+    def version(self):
+        self.transfers += 1
+        return 3, 0, 0
+
+    def set_tdi(self, value=True):
+        self.transfers += 1
+        self._tdi = int(bool(value))
+
+    def set_tms(self, value=True):
+        self.transfers += 1
+        self._tms = int(bool(value))
+        self._ir = None
+
+    def _set_state(self, state):
+        if not (state == JTAG.STATE_RUNIDLE or
+                JTAG.STATE_DRSELECT <= state <= JTAG.STATE_DRUPDATE):
+            self._ir = None
+        self._tdi = 1
+        if state == JTAG.STATE_RESET:
+            path = (1,) * 5
+        elif not set_state_supported(self._state, state):
+            # The firmware silently ignores moves it has no sequence for
+            return
+        else:
+            # Clocked from where the firmware believes the TAP is
+            path = tap_path(self._state, state)
+        for tms in path:
+            self._tms = tms
+            self._clock()
+        self._state = state
+
+    def set_state(self, state):
+        self.transfers += 1
+        self._set_state(state)
+
+    def clock(self, cycles):
+        self.transfers += 1
+        for _ in range(cycles):
+            self._clock()
+
+    def set_tck_delay(self, delay):
+        self.transfers += 1
+        self.tck_delay = delay
+
+    def _shift_exit(self):
+        self._tms = 1
+        self._state = {
+            JTAG.STATE_DRSHIFT: JTAG.STATE_DREXIT1,
+            JTAG.STATE_DRPAUSE: JTAG.STATE_DREXIT2,
+            JTAG.STATE_IRSHIFT: JTAG.STATE_IREXIT1,
+            JTAG.STATE_IRPAUSE: JTAG.STATE_IREXIT2,
+        }.get(self._state, self._state)
+
+    def _shift(self, bits, value, exit):
+        result = 0
+        for bit in range(bits):
+            if value is not None:
+                self._tdi = (value >> bit) & 1
+            if exit and bit == bits - 1:
+                self._shift_exit()
+            result |= self._clock() << bit
+        return result
+
+    def shift(self, bits, exit=True):
+        self.transfers += 1
+        self._shift(bits, 0, exit)
+
+    def shift_out(self, bits, value: int, exit=True):
+        self.transfers += 1
+        self._shift(bits, value, exit)
+
+    def shift_in(self, bits, exit=True):
+        self.transfers += 2
+        return self._shift(bits, None, exit)
+
+    def shift_outin(self, bits, value, exit=True):
+        self.transfers += 2
+        return self._shift(bits, value, exit)
+
+    def scan(self, bits, tdi=None, tdo=None, exit=True):
+        if not 0 < bits <= self.max_scan_bits:
+            raise ValueError('Invalid scan length')
+        n_bytes = (bits + 7) // 8
+        self.transfers += 1 if tdo is None else 2
+        value = None if tdi is None else int.from_bytes(tdi[:n_bytes],
+                'little')
+        if tdi is None and tdo is None:
+            value = 0
+        result = self._shift(bits, value, exit)
+        if tdo is not None:
+            tdo[:n_bytes] = result.to_bytes(n_bytes, 'little')
+
+    def bulk_write_bytes(self, data: bytes) -> None:
+        self.transfers += -(-len(data) // self.arena_size)
+        for byte in data:
+            self._set_state(JTAG.STATE_DRSHIFT)
+            self._shift(8, byte, True)
+            self._set_state(JTAG.STATE_RUNIDLE)
+
+    def bulk_read_bytes(self, count: int) -> bytes:
+        self.transfers += -(-count // self.arena_size)
+        data = bytearray()
+        for _ in range(count):
+            self._set_state(JTAG.STATE_DRSHIFT)
+            data.append(self._shift(8, None, True))
+            self._set_state(JTAG.STATE_RUNIDLE)
+        return bytes(data)
+
+    def _shift_reg(self, state, bits, value):
+        self._set_state(state)
+        result = self._shift(bits, value, True)
+        self._set_state(JTAG.STATE_RUNIDLE)
+        return result
+
+    def avr_read_ocdr(self):
+        self.transfers += 1
+        if self._ir != AVR_IR_PRIVATE3:
+            self._shift_reg(JTAG.STATE_IRSHIFT, 4, AVR_IR_PRIVATE3)
+            self._ir = AVR_IR_PRIVATE3
+        self._shift_reg(JTAG.STATE_DRSHIFT, 5, 0xD)
+        status = self._shift_reg(JTAG.STATE_DRSHIFT, 16, 0)
+        ch = None
+        if status & 0x10:
+            self._shift_reg(JTAG.STATE_DRSHIFT, 5, 0xC)
+            ch = bytes((self._shift_reg(JTAG.STATE_DRSHIFT, 16, 0) >> 8,))
+        return ch
+
+    def avr_ocd_regs(self, data: bytes) -> bytes:
+        step = self.arena_size // 3 * 3
+        for pos in range(0, len(data), step):
+            # One OUT per chunk, plus a READBUF when it reads anything
+            chunk = data[pos:pos + step]
+            self.transfers += 1 + any(
+                    not reg & (OCD_REG_WRITE | OCD_REG_EXEC)
+                    for reg in chunk[::3])
+        result = bytearray()
+        for pos in range(0, len(data) - 2, 3):
+            reg = data[pos] & 0xF
+            value = int.from_bytes(data[pos + 1:pos + 3], 'little')
+            ir = AVR_IR_PRIVATE2 if data[pos] & OCD_REG_EXEC else \
+                    AVR_IR_PRIVATE3
+            if self._ir != ir:
+                self._shift_reg(JTAG.STATE_IRSHIFT, 4, ir)
+                self._ir = ir
+            if ir == AVR_IR_PRIVATE2:
+                self._shift_reg(JTAG.STATE_DRSHIFT, 16, value)
+                continue
+            self._shift_reg(JTAG.STATE_DRSHIFT, 5, reg)
+            if data[pos] & OCD_REG_WRITE:
+                self._shift_reg(JTAG.STATE_DRSHIFT, 21,
+                        (1 << 20) | (reg << 16) | value)
+            else:
+                value = self._shift_reg(JTAG.STATE_DRSHIFT, 16, 0)
+                result += value.to_bytes(2, 'little')
+        return bytes(result)
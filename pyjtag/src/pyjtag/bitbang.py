@@ -0,0 +1,191 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import select
+import socket
+
+from .bitvector import BitVector
+from .jtag import JTAG
+from .tap import TAP_NEXT
+
+SHIFT_STATES = (JTAG.STATE_DRSHIFT, JTAG.STATE_IRSHIFT)
+
+
+class Bridge:
+    """
+    Translates OpenOCD remote_bitbang traffic into FreeJTAG requests.
+
+    TCK rising edges are queued as (tms, tdi, slots) and only executed when
+    OpenOCD needs TDO or goes idle.  The TAP state is followed from the TMS
+    stream so runs of shift bits become single scan requests and everything
+    else becomes TMS/clock runs.
+    """
+
+    def __init__(self, backend):
+        self.backend = backend
+        self.max_scan_bits = getattr(backend, 'max_scan_bits', None) or 256
+        self.tck = self.tms = self.tdi = 0
+        self.bits = []
+        self.responses = []
+        self._samples = ()
+        self._swallow = False
+        self.backend.set_state(JTAG.STATE_RESET)
+        self.state = JTAG.STATE_RESET
+        self._pin_tms = 1
+
+    def feed(self, data):
+        quit = False
+        for ch in data:
+            if 0x30 <= ch <= 0x37:
+                value = ch - 0x30
+                tck = (value >> 2) & 1
+                self.tms = (value >> 1) & 1
+                self.tdi = value & 1
+                if tck and not self.tck:
+                    self._rising_edge()
+                self.tck = tck
+            elif ch == ord('R'):
+                self._samples += (len(self.responses),)
+                self.responses.append(None)
+            elif ch in b'rstu':
+                if ch in b'tu':
+                    self.flush()
+                    self.backend.set_state(JTAG.STATE_RESET)
+                    self.state = JTAG.STATE_RESET
+                    self._pin_tms = 1
+            elif ch == ord('Q'):
+                quit = True
+                break
+        return quit
+
+    def _rising_edge(self):
+        if self._swallow:
+            self._swallow = False
+            return
+        self.bits.append((self.tms, self.tdi, self._samples))
+        self._samples = ()
+
+    def take_responses(self):
+        data = bytes(self.responses)
+        self.responses.clear()
+        return data
+
+    def flush(self):
+        if self._samples:
+            # OpenOCD wants TDO before the edge that shifts it, so clock
+            # that edge now and drop it when it arrives.
+            self.bits.append((self.tms, self.tdi, self._samples))
+            self._samples = ()
+            self._swallow = True
+
+        bits, self.bits = self.bits, []
+        i = 0
+        while i < len(bits):
+            if self.state in SHIFT_STATES:
+                i = self._shift_run(bits, i)
+            else:
+                i = self._clock_run(bits, i)
+
+    def _set_tms(self, tms):
+        if self._pin_tms != tms:
+            self.backend.set_tms(tms)
+            self._pin_tms = tms
+
+    def _respond(self, slots, tdo):
+        for slot in slots:
+            self.responses[slot] = ord('1') if tdo else ord('0')
+
+    def _clock_run(self, bits, i):
+        tms = bits[i][0]
+        n = 0
+        while i + n < len(bits) and bits[i + n][0] == tms and \
+                self.state not in SHIFT_STATES:
+            # TDO is not driven outside the shift states
+            self._respond(bits[i + n][2], 1)
+            self.state = TAP_NEXT.get(self.state, (self.state,) * 2)[tms]
+            n += 1
+
+        self._set_tms(tms)
+        remaining = n
+        while remaining > 0:
+            cycles = min(remaining, 256)
+            self.backend.clock(cycles)
+            remaining -= cycles
+        return i + n
+
+    def _shift_run(self, bits, i):
+        end = i
+        while end < len(bits) and bits[end][0] == 0:
+            end += 1
+        exit = end < len(bits)
+        if exit:
+            end += 1
+
+        run = bits[i:end]
+        read = any(slots for _, _, slots in run)
+        tdi = BitVector.from_bits(tdi for _, tdi, _ in run)
+        if not read and not any(tdi.buf):
+            tdi = None
+        tdo = BitVector(len(run)) if read else None
+        if read and tdi is None:
+            tdi = BitVector(len(run))
+
+        self._set_tms(0)
+        tdi_view = memoryview(tdi.buf) if tdi is not None else None
+        tdo_view = memoryview(tdo.buf) if tdo is not None else None
+        limit = self.max_scan_bits & ~7
+        pos = 0
+        while pos < len(run):
+            n = min(limit, len(run) - pos)
+            span = slice(pos >> 3, (pos + n + 7) >> 3)
+            last = pos + n == len(run)
+            self.backend.scan(n,
+                    tdi_view[span] if tdi_view is not None else None,
+                    tdo_view[span] if tdo_view is not None else None,
+                    exit and last)
+            pos += n
+
+        if tdo is not None:
+            for index, (_, _, slots) in enumerate(run):
+                self._respond(slots, tdo[index])
+        if exit:
+            self._pin_tms = 1
+            self.state = TAP_NEXT[self.state][1]
+        return end
+
+
+def serve(backend, host='127.0.0.1', port=3335, once=False):
+    server = socket.create_server((host, port))
+    try:
+        while True:
+            conn, _ = server.accept()
+            with conn:
+                conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                bridge = Bridge(backend)
+                handle(bridge, conn)
+            if once:
+                break
+    finally:
+        server.close()
+
+
+def handle(bridge, conn):
+    while True:
+        try:
+            data = conn.recv(65536)
+        except ConnectionError:
+            data = b''
+        quit = not data or bridge.feed(data)
+
+        # Keep coalescing while OpenOCD is still sending, and only touch
+        # the probe once it stops to wait for TDO or goes idle.
+        if not quit and select.select([conn], [], [], 0)[0]:
+            continue
+
+        bridge.flush()
+        responses = bridge.take_responses()
+        if responses:
+            conn.sendall(responses)
+        if quit:
+            return
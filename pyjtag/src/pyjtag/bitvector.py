@@ -0,0 +1,133 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+# Bit 0 is the first bit shifted, stored in the LSB of byte 0, matching the
+# firmware's scan buffers.
+class BitVector:
+    __slots__ = ('buf', 'length')
+
+    def __init__(self, length=0, value=None):
+        self.length = length
+        self.buf = bytearray((length + 7) // 8)
+        if value is None:
+            return
+        if isinstance(value, int):
+            if value < 0:
+                value &= (1 << length) - 1
+            self.buf[:] = value.to_bytes(len(self.buf), 'little') \
+                    if length else b''
+        else:
+            data = memoryview(value).cast('B')
+            n = min(len(data), len(self.buf))
+            self.buf[:n] = data[:n]
+        self._mask()
+
+    @classmethod
+    def from_bits(cls, bits):
+        bits = list(bits)
+        vector = cls(len(bits))
+        for i, bit in enumerate(bits):
+            if bit:
+                vector.buf[i >> 3] |= 1 << (i & 7)
+        return vector
+
+    @classmethod
+    def from_str(cls, text):
+        # MSB first, as bit strings are usually written
+        text = text.replace('_', '')
+        return cls.from_bits(int(c) for c in reversed(text))
+
+    def _mask(self):
+        if self.length & 7:
+            self.buf[-1] &= (1 << (self.length & 7)) - 1
+
+    def __len__(self):
+        return self.length
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            start, stop, step = index.indices(self.length)
+            if step != 1:
+                return BitVector.from_bits(self[i]
+                        for i in range(start, stop, step))
+            return self.extract(start, max(stop - start, 0))
+        if index < 0:
+            index += self.length
+        if not 0 <= index < self.length:
+            raise IndexError('BitVector index out of range')
+        return (self.buf[index >> 3] >> (index & 7)) & 1
+
+    def __setitem__(self, index, value):
+        if isinstance(index, slice):
+            start, stop, step = index.indices(self.length)
+            if step != 1 or len(value) != stop - start:
+                raise ValueError('Slice assignment must not resize')
+            self.insert(start, value)
+            return
+        if index < 0:
+            index += self.length
+        if not 0 <= index < self.length:
+            raise IndexError('BitVector index out of range')
+        if value:
+            self.buf[index >> 3] |= 1 << (index & 7)
+        else:
+            self.buf[index >> 3] &= ~(1 << (index & 7))
+
+    def extract(self, start, bits):
+        vector = BitVector(bits)
+        if start & 7 == 0:
+            vector.buf[:] = self.buf[start >> 3:(start >> 3) + len(vector.buf)]
+        else:
+            value = int.from_bytes(self.buf[start >> 3:
+                    (start + bits + 7) // 8 + 1], 'little')
+            value >>= start & 7
+            vector.buf[:] = (value & ((1 << bits) - 1)).to_bytes(
+                    len(vector.buf), 'little')
+        vector._mask()
+        return vector
+
+    def insert(self, start, vector):
+        if not isinstance(vector, BitVector):
+            vector = BitVector(len(vector), vector)
+        bits = vector.length
+        if start + bits > self.length:
+            raise ValueError('BitVector insert out of range')
+        if start & 7 == 0 and bits & 7 == 0:
+            self.buf[start >> 3:(start + bits) >> 3] = vector.buf
+            return
+        first = start >> 3
+        last = (start + bits + 7) >> 3
+        value = int.from_bytes(self.buf[first:last], 'little')
+        mask = ((1 << bits) - 1) << (start & 7)
+        value = (value & ~mask) | (vector.to_int() << (start & 7))
+        self.buf[first:last] = value.to_bytes(last - first, 'little')
+
+    def to_int(self):
+        return int.from_bytes(self.buf, 'little')
+
+    def to_bytes(self):
+        return bytes(self.buf)
+
+    def copy(self):
+        return BitVector(self.length, self.buf)
+
+    def __int__(self):
+        return self.to_int()
+
+    def __eq__(self, other):
+        if not isinstance(other, BitVector):
+            return NotImplemented
+        return self.length == other.length and self.buf == other.buf
+
+    def __add__(self, other):
+        vector = BitVector(self.length + other.length)
+        vector.insert(0, self)
+        vector.insert(self.length, other)
+        return vector
+
+    def __str__(self):
+        return ''.join(str(self[i]) for i in reversed(range(self.length)))
+
+    def __repr__(self):
+        return f'BitVector({self.length}, 0x{self.to_int():X})'
@@ -0,0 +1,224 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import re
+
+from .bitvector import BitVector
+
+ATTRIBUTE_RE = re.compile(
+        r'attribute\s+(\w+)\s+of\s+\w+\s*:\s*\w+\s+is\s+(.*?);',
+        re.IGNORECASE | re.DOTALL)
+STRING_RE = re.compile(r'"([^"]*)"')
+OPCODE_RE = re.compile(r'(\w+)\s*\(([^)]*)\)')
+CELL_RE = re.compile(r'(\d+)\s*\(([^)]*)\)')
+
+SAMPLE_NAMES = ('SAMPLE', 'SAMPLE_PRELOAD', 'PRELOAD')
+
+
+class BSDLError(Exception):
+    pass
+
+
+class Cell:
+    __slots__ = ('num', 'kind', 'port', 'function', 'safe', 'control',
+            'disable')
+
+    def __init__(self, num, kind, port, function, safe, control=None,
+            disable=None):
+        self.num = num
+        self.kind = kind
+        self.port = port
+        self.function = function
+        self.safe = safe
+        self.control = control
+        self.disable = disable
+
+
+class Pin:
+    __slots__ = ('name', 'input', 'output', 'control', 'disable')
+
+    def __init__(self, name):
+        self.name = name
+        self.input = None
+        self.output = None
+        self.control = None
+        self.disable = None
+
+
+class BSDL:
+    def __init__(self, entity, ir_length, opcodes, cells):
+        self.entity = entity
+        self.ir_length = ir_length
+        self.opcodes = opcodes
+        self.cells = cells
+        self.length = len(cells)
+        self.pins = {}
+        for cell in cells:
+            if cell.port == '*':
+                continue
+            pin = self.pins.setdefault(cell.port, Pin(cell.port))
+            if cell.function in ('INPUT', 'BIDIR', 'CLOCK', 'OBSERVE_ONLY'):
+                pin.input = cell.num
+            if cell.function in ('OUTPUT2', 'OUTPUT3', 'BIDIR'):
+                pin.output = cell.num
+                if cell.control is not None:
+                    pin.control = cell.control
+                    pin.disable = cell.disable
+
+    @classmethod
+    def parse(cls, text):
+        text = re.sub(r'--[^\n]*', '', text)
+        entity = re.search(r'entity\s+(\w+)\s+is', text, re.IGNORECASE)
+        attributes = {}
+        for name, value in ATTRIBUTE_RE.findall(text):
+            strings = STRING_RE.findall(value)
+            attributes[name.upper()] = ''.join(strings) if strings else \
+                    value.strip()
+
+        try:
+            ir_length = int(attributes['INSTRUCTION_LENGTH'])
+            length = int(attributes['BOUNDARY_LENGTH'])
+            opcodes = {name.upper(): int(codes.split(',')[0].strip(), 2)
+                    for name, codes in OPCODE_RE.findall(
+                            attributes['INSTRUCTION_OPCODE'])}
+            register = attributes['BOUNDARY_REGISTER']
+        except KeyError as e:
+            raise BSDLError(f'Missing attribute {e.args[0]}')
+        except ValueError as e:
+            raise BSDLError(str(e))
+
+        cells = [None] * length
+        for num, fields in CELL_RE.findall(register):
+            fields = [field.strip() for field in fields.split(',')]
+            if len(fields) < 4:
+                raise BSDLError(f'Malformed boundary cell {num}')
+            num = int(num)
+            if num >= length:
+                raise BSDLError(f'Boundary cell {num} out of range')
+            control = disable = None
+            if len(fields) >= 6:
+                control, disable = int(fields[4]), int(fields[5])
+            cells[num] = Cell(num, fields[0], fields[1],
+                    fields[2].upper(), fields[3].upper(), control, disable)
+        if None in cells:
+            raise BSDLError(f'Boundary cell {cells.index(None)} not defined')
+        return cls(entity.group(1) if entity else None, ir_length, opcodes,
+                cells)
+
+    @classmethod
+    def load(cls, path):
+        with open(path) as f:
+            return cls.parse(f.read())
+
+    def safe_vector(self):
+        return BitVector.from_bits(cell.safe == '1' for cell in self.cells)
+
+
+class BoundaryScan:
+    """
+    Pin-level access to a boundary register.
+
+    set() only edits the pending output vector.  Nothing is shifted until
+    flush() or a get(), and flush() only shifts if the vector differs from
+    the one last shifted, so thousands of pin updates become one long scan.
+    get() always scans for fresh inputs; get_cached() reads the last
+    capture instead, so many pins can be read from one scan.  Inputs
+    captured by a scan reflect the outputs from before its update, so a
+    read after a change costs one more scan.
+    """
+
+    def __init__(self, jtag, bsdl):
+        self.jtag = jtag
+        self.bsdl = bsdl
+        self.out = bsdl.safe_vector()
+        self.shifted = None
+        self.captured = None
+        self.instruction = None
+        self.driving = False
+
+    def _load(self, name):
+        try:
+            opcode = self.bsdl.opcodes[name]
+        except KeyError:
+            raise BSDLError(f'{self.bsdl.entity} has no {name} instruction')
+        self.jtag.shift_ir(self.bsdl.ir_length, opcode)
+        self.instruction = name
+
+    def _scan(self):
+        vector = self.out.copy()
+        self.captured = self.jtag.shift_dr(vector, read=True)
+        self.shifted = self.out.copy()
+
+    def _pin(self, name):
+        try:
+            return self.bsdl.pins[name]
+        except KeyError:
+            raise BSDLError(f'Unknown pin {name!r}')
+
+    def sample(self):
+        """Capture the pins without driving them."""
+        if self.instruction != 'SAMPLE':
+            self._load(next((name for name in SAMPLE_NAMES
+                    if name in self.bsdl.opcodes), 'SAMPLE'))
+            self.instruction = 'SAMPLE'
+        self._scan()
+        return self.captured
+
+    def extest(self):
+        """Preload the pending outputs, then drive them with EXTEST."""
+        self.driving = True
+        if self.instruction == 'EXTEST':
+            return
+        self.sample()
+        self._load('EXTEST')
+
+    def set(self, name, value):
+        """Drive a pin 0 or 1, or release it with None."""
+        pin = self._pin(name)
+        self.driving = True
+        if pin.control is not None:
+            self.out[pin.control] = pin.disable if value is None else \
+                    not pin.disable
+        elif value is None:
+            raise BSDLError(f'Pin {name!r} cannot be released')
+        if value is not None:
+            if pin.output is None:
+                raise BSDLError(f'Pin {name!r} is not an output')
+            self.out[pin.output] = value
+
+    def flush(self):
+        if self.instruction != 'EXTEST':
+            self.extest()
+        if self.shifted is not None and self.out == self.shifted:
+            return False
+        self._scan()
+        return True
+
+    def capture(self):
+        """Drive the pending outputs and scan in the pins."""
+        if not self.driving:
+            # Nothing set yet, so just sample
+            return self.sample()
+        self.flush()
+        self._scan()
+        return self.captured
+
+    def _input(self, name):
+        pin = self._pin(name)
+        if pin.input is None:
+            raise BSDLError(f'Pin {name!r} is not an input')
+        return pin
+
+    def get(self, name):
+        pin = self._input(name)
+        return self.capture()[pin.input]
+
+    def get_cached(self, name):
+        """Read a pin from the last capture, scanning only when there is
+        none or outputs are still pending."""
+        pin = self._input(name)
+        if self.captured is None or \
+                (self.driving and self.out != self.shifted):
+            self.capture()
+        return self.captured[pin.input]
@@ -0,0 +1,102 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import json
+import os
+
+from .jtag import JTAG
+
+# Slowest first, each step roughly doubles the TCK rate
+TCK_DELAYS = (255, 128, 64, 32, 16, 8, 4, 2, 1, 0)
+TCK_DELAY_MAX = TCK_DELAYS[0]
+
+BYPASS_PATTERN = 0xA5C3_96F0_0FF0_5A3C
+BYPASS_BITS = 64
+
+
+def config_path():
+    base = os.environ.get('XDG_CONFIG_HOME') or \
+            os.path.join(os.path.expanduser('~'), '.config')
+    return os.path.join(base, 'pyjtag', 'tck.json')
+
+
+def load_delays():
+    try:
+        with open(config_path()) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return {}
+
+
+def save_delay(idcode, delay):
+    delays = load_delays()
+    delays[f'{idcode:08X}'] = delay
+    path = config_path()
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, 'w') as f:
+        json.dump(delays, f, indent=2, sort_keys=True)
+
+
+def saved_delay(jtag):
+    """
+    Look up the calibrated delay for the attached target, for use as
+    JTAG(tck_delay=saved_delay).  The IDCODE is read at the slowest rate,
+    targets that were never calibrated run at full speed.
+    """
+    jtag.set_tck_delay(TCK_DELAY_MAX)
+    return load_delays().get(f'{jtag.read_idcode():08X}', 0)
+
+
+class Calibration:
+    def __init__(self, idcode, results, delay):
+        self.idcode = idcode
+        self.results = results
+        self.delay = delay
+
+    def __str__(self):
+        lines = [f'IDCODE 0x{self.idcode:08X}']
+        for delay, passed in self.results:
+            lines.append(f'  delay {delay:3}: {"pass" if passed else "FAIL"}')
+        lines.append(f'Selected delay {self.delay}')
+        return '\n'.join(lines)
+
+
+def reference(jtag, ir_length):
+    idcode = jtag.read_idcode()
+    jtag.shift_ir(ir_length, (1 << ir_length) - 1)
+    bypass = jtag.shift_dr(BYPASS_BITS + 1, BYPASS_PATTERN, read=True)
+    return idcode, bypass
+
+
+def calibrate(jtag, rounds=16, ir_length=4):
+    """
+    Step TCK up from the slowest setting, repeating the IDCODE read and a
+    pattern through BYPASS at each step and comparing both with what the
+    slowest setting captured.  Stop at the first failure and back off one
+    step from the fastest pass for margin.  That holds when every step
+    passes too, a target that scans cleanly at full speed on the bench
+    may not with a warmer board or a longer cable.
+    """
+    jtag.set_tck_delay(TCK_DELAY_MAX)
+    expected = reference(jtag, ir_length)
+    idcode = expected[0]
+    if not idcode & 1 or idcode == 0xFFFFFFFF:
+        raise RuntimeError('No valid IDCODE at the slowest TCK rate')
+
+    results = []
+    for delay in TCK_DELAYS:
+        jtag.set_tck_delay(delay)
+        passed = all(reference(jtag, ir_length) == expected
+                for _ in range(rounds))
+        results.append((delay, passed))
+        if not passed:
+            break
+
+    passing = [delay for delay, passed in results if passed]
+    if not passing:
+        raise RuntimeError('Scans fail even at the slowest TCK rate')
+    delay = passing[-2] if len(passing) > 1 else passing[-1]
+    jtag.set_tck_delay(delay)
+    jtag.set_state(JTAG.STATE_RESET)
+    return Calibration(idcode, results, delay)
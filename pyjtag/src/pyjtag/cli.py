@@ -0,0 +1,305 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import click
+
+from .bitbang import serve as serve_bitbang
+from .bscan import BSDL, BSDLError, BoundaryScan
+from .calibrate import calibrate as run_calibration, save_delay, saved_delay
+from .daemon import default_socket, serve as serve_daemon
+from .gang import IdentifyJob, ReplayJob, get_serials, run as run_gang
+from .gdbserver import serve as serve_gdb
+from .jtag import JTAG, IR_IDCODE
+from .replay import Recorder, ReplayError, load, replay as replay_calls
+from .svf import SVFError, play as play_svf
+from .trace import Trace
+from .util import HexParamType, parse_backend_options
+from .xsvf import STATUS_COMPLETE, XSVFError, play as play_xsvf
+
+
+class Session:
+    def __init__(self, backend, trace_file, histogram, record_file, kwargs):
+        self.backend = backend
+        self.kwargs = kwargs
+        self.trace_file = trace_file
+        self.histogram = histogram
+        self.trace = Trace() if trace_file or histogram else None
+        self.recorder = Recorder(record_file) if record_file else None
+
+    def open(self, **kwargs):
+        return JTAG(self.backend, trace=self.trace, record=self.recorder,
+                **{**self.kwargs, **kwargs})
+
+    def close(self):
+        if self.recorder:
+            self.recorder.close()
+        if self.trace_file:
+            self.trace.save_chrome(self.trace_file)
+        if self.histogram:
+            click.echo(self.trace.summary(), err=True)
+
+
+@click.group(invoke_without_command=True)
+@click.option('--backend', default='freejtag')
+@click.option('--vid', type=HexParamType('vid'))
+@click.option('--pid', type=HexParamType('pid'))
+@click.option('--index', type=click.INT)
+@click.option('-o', '--option', 'options', multiple=True, metavar='KEY=VALUE',
+        help='Extra backend option, may be repeated.')
+@click.option('--trace', 'trace_file', type=click.Path(dir_okay=False),
+        help='Write a Chrome/Perfetto trace of all operations.')
+@click.option('--histogram', is_flag=True,
+        help='Print per-operation latency histograms on exit.')
+@click.option('--record', 'record_file', type=click.Path(dir_okay=False),
+        help='Record every backend call to a binary session log.')
+@click.option('--tck-delay', metavar='N|auto',
+        help='TCK delay 0-255, or auto to use the value saved by '
+        'calibrate.')
+@click.pass_context
+def main(ctx, backend, options, trace_file, histogram, record_file, tck_delay,
+        **kwargs):
+    kwargs.update(parse_backend_options(options))
+    if tck_delay == 'auto':
+        kwargs['tck_delay'] = saved_delay
+    elif tck_delay is not None:
+        try:
+            kwargs['tck_delay'] = int(tck_delay, 0)
+        except ValueError:
+            kwargs['tck_delay'] = -1
+        if not 0 <= kwargs['tck_delay'] <= 255:
+            raise click.BadParameter(f'{tck_delay!r} is not 0-255 or auto',
+                    param_hint='--tck-delay')
+    ctx.obj = Session(backend, trace_file, histogram, record_file, kwargs)
+    ctx.call_on_close(ctx.obj.close)
+    if ctx.invoked_subcommand is None:
+        ctx.invoke(info)
+
+
+@main.command(help='Print the IDCODE and AVR signature.')
+@click.pass_obj
+def info(session):
+    with session.open() as jtag:
+        jtag.shift_ir(4, IR_IDCODE)
+        idcode = jtag.shift_dr(32, read=True)
+        print(f'IDCODE = 0x{idcode:08X}')
+
+        jtag.avr_reset(True)
+        jtag.avr_prog_enable(True)
+
+        signature = jtag.avr_signature()
+        print('Signature: ' + ' '.join(f'{byte:02X}' for byte in signature))
+
+        jtag.avr_prog_enable(False)
+        jtag.avr_reset(False)
+
+
+@main.command(help='Find the fastest reliable TCK rate for the target and '
+        'save it for --tck-delay auto.')
+@click.option('--rounds', default=16, show_default=True,
+        type=click.IntRange(min=1), help='Verify scans per rate.')
+@click.option('--ir-length', default=4, show_default=True,
+        type=click.IntRange(min=1), help='Total IR length of the chain.')
+@click.option('--no-save', is_flag=True, help='Do not save the result.')
+@click.pass_obj
+def calibrate(session, rounds, ir_length, no_save):
+    with session.open(tck_delay=None) as jtag:
+        try:
+            result = run_calibration(jtag, rounds, ir_length)
+        except RuntimeError as e:
+            raise click.ClickException(str(e))
+    click.echo(str(result))
+    if not no_save:
+        save_delay(result.idcode, result.delay)
+
+
+@main.command(help='Replay a recorded session log and compare TDO results.')
+@click.argument('log', type=click.Path(exists=True, dir_okay=False))
+@click.option('--repeat', default=1, type=click.IntRange(min=1))
+@click.option('--no-check', is_flag=True, help='Do not compare results.')
+@click.option('--stop', is_flag=True, help='Stop at the first mismatch.')
+@click.pass_obj
+def replay(session, log, repeat, no_check, stop):
+    try:
+        calls = load(log)
+    except ReplayError as e:
+        raise click.ClickException(str(e))
+
+    failed = False
+    with session.open() as jtag:
+        for _ in range(repeat):
+            result = replay_calls(jtag.backend, calls, check=not no_check,
+                    stop=stop, skip_attach=True)
+            for mismatch in result.mismatches:
+                click.echo(str(mismatch), err=True)
+            click.echo(str(result))
+            failed |= bool(result.mismatches)
+    if failed:
+        raise SystemExit(1)
+
+
+@main.command(help='Serve the OpenOCD remote_bitbang protocol.')
+@click.option('--host', default='127.0.0.1', show_default=True)
+@click.option('--port', default=3335, show_default=True)
+@click.option('--once', is_flag=True, help='Exit after the first client.')
+@click.pass_obj
+def bitbang(session, host, port, once):
+    with session.open() as jtag:
+        click.echo(f'Listening for OpenOCD remote_bitbang on {host}:{port}',
+                err=True)
+        try:
+            serve_bitbang(jtag.backend, host, port, once)
+        except KeyboardInterrupt:
+            pass
+
+
+@main.command(help='Share the probe with other pyjtag clients over a Unix '
+        'socket, use them with --backend daemon.')
+@click.option('--socket', 'path', type=click.Path(dir_okay=False),
+        default=default_socket, show_default=True)
+@click.pass_obj
+def daemon(session, path):
+    with session.open() as jtag:
+        click.echo(f'Serving {session.backend} on {path}', err=True)
+        try:
+            serve_daemon(jtag.backend, path)
+        except KeyboardInterrupt:
+            pass
+
+
+@main.command(help='Serve the GDB remote protocol for AVR on-chip debug.')
+@click.option('--host', default='127.0.0.1', show_default=True)
+@click.option('--port', default=1234, show_default=True)
+@click.option('--once', is_flag=True, help='Exit after the first client.')
+@click.option('--ocdr-io', default=0x31, type=HexParamType('address'),
+        show_default=True, help='I/O address of OCDR on the target.')
+@click.pass_obj
+def gdbserver(session, host, port, once, ocdr_io):
+    with session.open() as jtag:
+        click.echo(f'Listening for GDB on {host}:{port}', err=True)
+        try:
+            serve_gdb(jtag, host, port, once, ocdr_io=ocdr_io)
+        except KeyboardInterrupt:
+            pass
+
+
+@main.command(help='Sample pins, or drive them with --set, through the '
+        'boundary register described by a BSDL file.')
+@click.argument('path', metavar='BSDL',
+        type=click.Path(exists=True, dir_okay=False))
+@click.argument('pins', nargs=-1)
+@click.option('--set', 'assignments', multiple=True, metavar='PIN=0|1|Z',
+        help='Drive a pin using EXTEST, may be repeated.')
+@click.pass_obj
+def bscan(session, path, pins, assignments):
+    levels = {'0': 0, '1': 1, 'z': None}
+    try:
+        bsdl = BSDL.load(path)
+        with session.open() as jtag:
+            scan = BoundaryScan(jtag, bsdl)
+            for assignment in assignments:
+                name, _, value = assignment.partition('=')
+                if value.lower() not in levels:
+                    raise click.BadParameter(f'{assignment!r} is not '
+                            'PIN=0|1|Z', param_hint='--set')
+                scan.set(name, levels[value.lower()])
+            # One capture for every pin listed
+            for name in pins or [pin.name for pin in bsdl.pins.values()
+                    if pin.input is not None]:
+                click.echo(f'{name} = {scan.get_cached(name)}')
+    except BSDLError as e:
+        raise click.ClickException(str(e))
+
+
+@main.command(help='Play an SVF file.')
+@click.argument('path', metavar='FILE',
+        type=click.Path(exists=True, dir_okay=False))
+@click.option('--batch', default=64, show_default=True,
+        type=click.IntRange(min=1),
+        help='TDO checks queued before comparing.')
+@click.pass_obj
+def svf(session, path, batch):
+    with session.open() as jtag:
+        try:
+            result = play_svf(jtag, path, batch)
+        except SVFError as e:
+            raise click.ClickException(f'{path}: {e}')
+    click.echo(str(result))
+
+
+@main.command(help='Play an XSVF file, on the probe when it supports it.')
+@click.argument('path', metavar='FILE',
+        type=click.Path(exists=True, dir_okay=False))
+@click.option('--chunk', default=1024, show_default=True,
+        type=click.IntRange(1, 4096),
+        help='Bytes streamed to the probe per transfer.')
+@click.pass_obj
+def xsvf(session, path, chunk):
+    with open(path, 'rb') as f:
+        data = f.read()
+    with session.open() as jtag:
+        try:
+            status = play_xsvf(jtag, data, chunk)
+        except XSVFError as e:
+            raise click.ClickException(str(e))
+    if status != STATUS_COMPLETE:
+        click.echo('Warning: no XCOMPLETE at end of file', err=True)
+    click.echo('XSVF complete')
+
+
+class Gang:
+    def __init__(self, session, serials):
+        self.session = session
+        self.serials = serials
+
+    def run(self, job):
+        result = run_gang(self.session.backend, self.serials, job,
+                **self.session.kwargs)
+        for board in result.boards:
+            click.echo(str(board))
+        click.echo(str(result))
+        if result.failed:
+            raise SystemExit(1)
+
+
+@main.group(help='Run the same job on several probes in parallel.')
+@click.option('--serial', 'serials', multiple=True,
+        help='Probe serial number, may be repeated.  Defaults to every '
+        'probe found.')
+@click.pass_context
+def gang(ctx, serials):
+    session = ctx.obj
+    if session.trace or session.recorder:
+        raise click.UsageError('--trace, --histogram and --record are not '
+                'supported in gang mode')
+    if not serials:
+        try:
+            serials = get_serials(session.backend, **session.kwargs)
+        except RuntimeError as e:
+            raise click.ClickException(str(e))
+    ctx.obj = Gang(session, serials)
+
+
+@gang.command('info', help='Read IDCODE and signature from every board.')
+@click.option('--expect-idcode', type=HexParamType('idcode'),
+        help='Fail boards whose IDCODE differs.')
+@click.pass_obj
+def gang_info(gang, expect_idcode):
+    gang.run(IdentifyJob(expect_idcode))
+
+
+@gang.command('replay', help='Replay a session log on every board.')
+@click.argument('log', type=click.Path(exists=True, dir_okay=False))
+@click.option('--no-check', is_flag=True, help='Do not compare results.')
+@click.pass_obj
+def gang_replay(gang, log, no_check):
+    try:
+        calls = load(log)
+    except ReplayError as e:
+        raise click.ClickException(str(e))
+    gang.run(ReplayJob(calls, check=not no_check))
+
+
+if __name__ == '__main__':
+    main()
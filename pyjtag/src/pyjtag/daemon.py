@@ -0,0 +1,267 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import os
+import selectors
+import socket
+import stat
+from collections import deque
+
+from .replay import (OPCODES, ReplayError, call, decode_args, decode_varint,
+        encode_value, encode_varint)
+
+# Frames are a varint length followed by a message type and its body.
+# Replies start with STATUS_OK and the results, or STATUS_ERROR and a
+# UTF-8 message.  MSG_INFO replies with the scan limit in bits (0 for
+# none) and 1 if the probe batches OCD register access.
+MSG_INFO        = 0x01
+MSG_CALLS       = 0x02
+MSG_BEGIN       = 0x03
+MSG_END         = 0x04
+
+STATUS_OK       = 0x00
+STATUS_ERROR    = 0x01
+
+# Deferred variants let a pipelining backend keep several reads in flight
+DEFERRED = ('shift_in', 'shift_outin')
+
+
+def default_socket():
+    runtime = os.environ.get('XDG_RUNTIME_DIR')
+    if runtime:
+        return os.path.join(runtime, 'pyjtag.sock')
+    # /tmp is shared, so each user gets their own daemon
+    return os.path.join('/tmp', f'pyjtag-{os.getuid()}.sock')
+
+
+def frame(payload):
+    out = bytearray()
+    encode_varint(len(payload), out)
+    return bytes(out + payload)
+
+
+def parse_frames(buf):
+    """Remove and yield complete frames from the front of buf."""
+    while buf:
+        try:
+            length, pos = decode_varint(buf, 0)
+        except ReplayError:
+            return
+        if len(buf) < pos + length:
+            return
+        payload = bytes(buf[pos:pos + length])
+        del buf[:pos + length]
+        yield payload
+
+
+def decode_batch(body):
+    calls = []
+    pos = 0
+    while pos < len(body):
+        name, args, pos = decode_args(body, pos)
+        calls.append((name, args))
+    return calls
+
+
+class Client:
+    def __init__(self, conn, name):
+        self.conn = conn
+        self.name = name
+        self.rxbuf = bytearray()
+        self.queue = deque()
+
+    def reply(self, status, body=b''):
+        try:
+            self.conn.sendall(frame(bytes((status,)) + body))
+        except OSError:
+            pass
+
+
+class Batch:
+    def __init__(self, client, calls):
+        self.client = client
+        self.calls = calls
+        self.results = []
+        self.error = None
+
+
+class Server:
+    """
+    Owns one backend and serves any number of clients on a Unix socket.
+
+    Each CALLS message runs without interruption.  Ready messages from all
+    clients are executed back to back in one round, with reads deferred
+    when the backend can pipeline them, so a console poll from one client
+    slots in between another client's batches.  BEGIN/END bracket a
+    transaction: while a client holds it, only its messages are run.
+    """
+
+    def __init__(self, backend, path=None):
+        self.backend = backend
+        self.path = path or default_socket()
+        self.clients = []
+        self.owner = None
+        self.selector = selectors.DefaultSelector()
+        self._next_id = 0
+
+    def _remove_stale(self):
+        try:
+            mode = os.lstat(self.path).st_mode
+        except FileNotFoundError:
+            return
+        if not stat.S_ISSOCK(mode):
+            raise RuntimeError(f'{self.path} exists and is not a socket')
+        probe = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            probe.connect(self.path)
+        except OSError:
+            # Left behind by a daemon that died, nothing is listening
+            os.unlink(self.path)
+        else:
+            raise RuntimeError(f'A pyjtag daemon is already serving '
+                    f'{self.path}')
+        finally:
+            probe.close()
+
+    def serve(self):
+        self._remove_stale()
+        server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        bound = False
+        try:
+            server.bind(self.path)
+            bound = True
+            os.chmod(self.path, 0o660)
+            server.listen()
+            self.selector.register(server, selectors.EVENT_READ)
+            while True:
+                for key, _ in self.selector.select():
+                    if key.fileobj is server:
+                        self._accept(server)
+                    else:
+                        self._receive(key.data)
+                while self._run():
+                    pass
+        finally:
+            for client in list(self.clients):
+                self._drop(client)
+            self.selector.close()
+            server.close()
+            # Only remove the socket this daemon created
+            if bound and os.path.exists(self.path):
+                os.unlink(self.path)
+
+    def _accept(self, server):
+        conn, _ = server.accept()
+        client = Client(conn, self._next_id)
+        self._next_id += 1
+        self.clients.append(client)
+        self.selector.register(conn, selectors.EVENT_READ, client)
+
+    def _drop(self, client):
+        self.selector.unregister(client.conn)
+        client.conn.close()
+        self.clients.remove(client)
+        if self.owner is client:
+            self.owner = None
+        if hasattr(self.backend, 'flush'):
+            self.backend.flush()
+
+    def _receive(self, client):
+        try:
+            data = client.conn.recv(65536)
+        except OSError:
+            data = b''
+        if not data:
+            self._drop(client)
+            return
+        client.rxbuf += data
+        client.queue.extend(parse_frames(client.rxbuf))
+
+    def _run(self):
+        """Run one round of ready messages, return True if any progressed."""
+        progress = False
+        batches = []
+        for client in list(self.clients):
+            if self.owner not in (None, client):
+                continue
+            while client.queue:
+                msg = client.queue[0][0]
+                if msg == MSG_BEGIN and self.owner not in (None, client):
+                    break
+                body = client.queue.popleft()[1:]
+                progress = True
+                if msg == MSG_INFO:
+                    out = bytearray()
+                    limit = getattr(self.backend, 'max_scan_bits', None)
+                    encode_varint(limit or 0, out)
+                    encode_varint(int(getattr(self.backend, 'has_ocd_regs',
+                            hasattr(self.backend, 'avr_ocd_regs'))), out)
+                    client.reply(STATUS_OK, out)
+                elif msg == MSG_BEGIN:
+                    self.owner = client
+                    client.reply(STATUS_OK)
+                elif msg == MSG_END:
+                    if self.owner is client:
+                        self.owner = None
+                    client.reply(STATUS_OK)
+                elif msg == MSG_CALLS:
+                    try:
+                        batches.append(Batch(client, decode_batch(body)))
+                    except ReplayError as e:
+                        client.reply(STATUS_ERROR, str(e).encode())
+                    # One batch per client per round keeps things fair
+                    break
+                else:
+                    client.reply(STATUS_ERROR,
+                            f'Unknown message 0x{msg:02X}'.encode())
+
+        if batches:
+            self._execute(batches)
+        return progress
+
+    def _execute(self, batches):
+        for batch in batches:
+            for name, args in batch.calls:
+                # The daemon owns the interface and attach state
+                if name in ('_acquire', '_release'):
+                    continue
+                try:
+                    deferred = getattr(self.backend, f'{name}_deferred', None) \
+                            if name in DEFERRED else None
+                    if deferred:
+                        result = deferred(*args)
+                    else:
+                        result = call(self.backend, name, args)
+                except Exception as e:
+                    batch.error = e
+                    break
+                if OPCODES[name][2]:
+                    batch.results.append((name, bool(deferred), result))
+
+        if hasattr(self.backend, 'flush'):
+            try:
+                self.backend.flush()
+            except Exception as e:
+                for batch in batches:
+                    batch.error = batch.error or e
+
+        for batch in batches:
+            out = bytearray()
+            try:
+                for name, deferred, result in batch.results:
+                    if deferred:
+                        result = result.result()
+                    encode_value(OPCODES[name][2], result, out)
+            except Exception as e:
+                batch.error = batch.error or e
+            if batch.error:
+                batch.client.reply(STATUS_ERROR,
+                        str(batch.error).encode() or
+                        type(batch.error).__name__.encode())
+            else:
+                batch.client.reply(STATUS_OK, out)
+
+
+def serve(backend, path=None):
+    Server(backend, path).serve()
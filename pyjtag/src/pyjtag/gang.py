@@ -0,0 +1,123 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import importlib
+from concurrent.futures import ThreadPoolExecutor
+from time import perf_counter
+
+from .jtag import JTAG, IR_IDCODE
+from .replay import replay
+
+
+def get_serials(backend, **kwargs):
+    mod = importlib.import_module(f'.{backend}', 'pyjtag.backends')
+    if not hasattr(mod.Backend, 'get_serials'):
+        raise RuntimeError(f'The {backend} backend cannot enumerate probes, '
+                'select them by serial')
+    kwargs.pop('index', None)
+    kwargs.pop('serial', None)
+    return mod.Backend.get_serials(**kwargs)
+
+
+class IdentifyJob:
+    """Read IDCODE and signature, optionally checking the IDCODE."""
+
+    def __init__(self, idcode=None):
+        self.idcode = idcode
+
+    def __call__(self, jtag):
+        jtag.shift_ir(4, IR_IDCODE)
+        idcode = jtag.shift_dr(32, read=True)
+
+        jtag.avr_reset(True)
+        jtag.avr_prog_enable(True)
+        signature = jtag.avr_signature()
+        jtag.avr_prog_enable(False)
+        jtag.avr_reset(False)
+
+        passed = self.idcode is None or idcode == self.idcode
+        detail = f'IDCODE 0x{idcode:08X}, signature ' + \
+                ' '.join(f'{byte:02X}' for byte in signature)
+        return passed, detail, 0
+
+
+class ReplayJob:
+    """Replay a session log that is parsed once and shared by all workers."""
+
+    def __init__(self, calls, check=True):
+        self.calls = calls
+        self.check = check
+
+    def __call__(self, jtag):
+        result = replay(jtag.backend, self.calls, check=self.check,
+                skip_attach=True)
+        detail = str(result)
+        if result.mismatches:
+            detail += f', first {result.mismatches[0]}'
+        return not result.mismatches, detail, result.bits
+
+
+class BoardResult:
+    def __init__(self, serial):
+        self.serial = serial
+        self.passed = False
+        self.detail = ''
+        self.bits = 0
+        self.transfers = 0
+        self.elapsed = 0.0
+
+    def __str__(self):
+        status = 'PASS' if self.passed else 'FAIL'
+        return (f'{self.serial}: {status} in {self.elapsed * 1000:.1f} ms, '
+                f'{self.transfers} transfers: {self.detail}')
+
+
+class GangResult:
+    def __init__(self, boards, elapsed):
+        self.boards = boards
+        self.elapsed = elapsed
+
+    @property
+    def failed(self):
+        return [board for board in self.boards if not board.passed]
+
+    def __str__(self):
+        bits = sum(board.bits for board in self.boards)
+        busy = sum(board.elapsed for board in self.boards)
+        elapsed = self.elapsed or float('inf')
+        text = (f'{len(self.boards) - len(self.failed)}/{len(self.boards)} '
+                f'passed in {self.elapsed * 1000:.1f} ms, '
+                f'{len(self.boards) / elapsed:.1f} boards/s')
+        if bits:
+            text += f', {bits / elapsed / 1000:.1f} kbit/s aggregate'
+        return text + f', {busy / elapsed:.1f}x parallel speedup'
+
+
+def run_board(backend, serial, job, kwargs):
+    board = BoardResult(serial)
+    start = perf_counter()
+    try:
+        with JTAG(backend, **{**kwargs, 'index': None, 'serial': serial}) \
+                as jtag:
+            board.passed, board.detail, board.bits = job(jtag)
+            board.transfers = getattr(jtag.backend, 'transfers', 0)
+    except Exception as e:
+        board.passed = False
+        board.detail = str(e) or type(e).__name__
+    board.elapsed = perf_counter() - start
+    return board
+
+
+def run(backend, serials, job, **kwargs):
+    """
+    Run job on every probe with one worker thread each.  The job object
+    is shared, so anything it parsed or precomputed is built only once.
+    USB transfers release the GIL, so the probes really run in parallel.
+    """
+    start = perf_counter()
+    with ThreadPoolExecutor(max_workers=max(len(serials), 1)) as executor:
+        boards = list(executor.map(
+                lambda serial: run_board(backend, serial, job, kwargs),
+                serials))
+    return GangResult(boards, perf_counter() - start)
@@ -0,0 +1,193 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import select
+import socket
+
+from .ocd import AVRDebugger, GDB_REG_SIZES
+
+SIGINT = 2
+SIGTRAP = 5
+
+
+def checksum(data):
+    return sum(data) & 0xFF
+
+
+def encode_reg(value, size):
+    return value.to_bytes(size, 'little').hex()
+
+
+class Connection:
+    def __init__(self, conn):
+        self.conn = conn
+        self.rxbuf = bytearray()
+        self.ack = True
+        self.interrupted = False
+
+    def _fill(self, timeout=None):
+        if timeout is not None and \
+                not select.select([self.conn], [], [], timeout)[0]:
+            return False
+        data = self.conn.recv(4096)
+        if not data:
+            raise ConnectionError('GDB disconnected')
+        if b'\x03' in data:
+            self.interrupted = True
+            data = data.replace(b'\x03', b'')
+        self.rxbuf += data
+        return True
+
+    def poll(self, timeout):
+        """Return True once GDB has sent a break (^C)."""
+        while select.select([self.conn], [], [], timeout)[0]:
+            self._fill()
+            timeout = 0
+        return self.interrupted
+
+    def receive(self):
+        while True:
+            start = self.rxbuf.find(b'$')
+            if start >= 0:
+                end = self.rxbuf.find(b'#', start)
+                if end >= 0 and len(self.rxbuf) >= end + 3:
+                    payload = bytes(self.rxbuf[start + 1:end])
+                    csum = self.rxbuf[end + 1:end + 3]
+                    del self.rxbuf[:end + 3]
+                    if not self.ack:
+                        return payload
+                    if int(csum, 16) == checksum(payload):
+                        self.conn.sendall(b'+')
+                        return payload
+                    self.conn.sendall(b'-')
+                    continue
+            elif self.interrupted:
+                self.interrupted = False
+                return b'\x03'
+            self._fill()
+
+    def send(self, payload):
+        if isinstance(payload, str):
+            payload = payload.encode()
+        self.conn.sendall(b'$' + payload +
+                b'#' + f'{checksum(payload):02x}'.encode())
+
+
+class GDBServer:
+    def __init__(self, debugger, conn):
+        self.debugger = debugger
+        self.conn = Connection(conn)
+
+    def run(self):
+        self.debugger.halt()
+        while True:
+            packet = self.conn.receive()
+            if packet == b'\x03':
+                self.debugger.halt()
+                self.conn.send(f'S{SIGINT:02x}')
+                continue
+            try:
+                reply = self.handle(packet.decode('latin-1'))
+            except (ValueError, IndexError):
+                reply = 'E01'
+            if reply is None:
+                return
+            self.conn.send(reply)
+            if packet == b'QStartNoAckMode':
+                self.conn.ack = False
+
+    def handle(self, packet):
+        if not packet:
+            return ''
+        cmd, args = packet[:1], packet[1:]
+        debugger = self.debugger
+
+        if cmd == '?':
+            return f'S{SIGTRAP:02x}'
+        if cmd == 'q':
+            if args.startswith('Supported'):
+                return 'PacketSize=4000;QStartNoAckMode+'
+            if args == 'Attached':
+                return '1'
+            return ''
+        if packet == 'QStartNoAckMode':
+            return 'OK'
+        if cmd == 'g':
+            regs = debugger.read_registers()
+            return ''.join(encode_reg(value, size)
+                    for value, size in zip(regs, GDB_REG_SIZES))
+        if cmd == 'G':
+            data = bytes.fromhex(args)
+            pos = 0
+            for index, size in enumerate(GDB_REG_SIZES):
+                value = int.from_bytes(data[pos:pos + size], 'little')
+                if value != debugger.read_registers()[index]:
+                    debugger.write_register(index, value)
+                pos += size
+            return 'OK'
+        if cmd == 'p':
+            index = int(args, 16)
+            return encode_reg(debugger.read_registers()[index],
+                    GDB_REG_SIZES[index])
+        if cmd == 'P':
+            index, value = args.split('=')
+            index = int(index, 16)
+            debugger.write_register(index,
+                    int.from_bytes(bytes.fromhex(value), 'little'))
+            return 'OK'
+        if cmd == 'm':
+            addr, length = (int(x, 16) for x in args.split(','))
+            return debugger.read_memory(addr, length).hex()
+        if cmd == 'M':
+            where, data = args.split(':')
+            addr, length = (int(x, 16) for x in where.split(','))
+            debugger.write_memory(addr, bytes.fromhex(data)[:length])
+            return 'OK'
+        if cmd in 'Zz' and args[:1] == '1':
+            _, addr, _ = args.split(',')
+            if cmd == 'z':
+                debugger.remove_breakpoint(int(addr, 16))
+                return 'OK'
+            return 'OK' if debugger.add_breakpoint(int(addr, 16)) else 'E01'
+        if cmd == 's':
+            debugger.step()
+            return self.wait()
+        if cmd == 'c':
+            debugger.cont()
+            return self.wait()
+        if cmd in 'kD':
+            if cmd == 'D':
+                debugger.cont()
+                self.conn.send('OK')
+            return None
+        return ''
+
+    def wait(self):
+        while True:
+            if self.debugger.stopped():
+                return f'S{SIGTRAP:02x}'
+            console = self.debugger.read_console()
+            if console:
+                self.conn.send(b'O' + console.hex().encode())
+            if self.conn.poll(0.01 if not console else 0):
+                self.conn.interrupted = False
+                self.debugger.halt()
+                return f'S{SIGINT:02x}'
+
+
+def serve(jtag, host='127.0.0.1', port=1234, once=False, **kwargs):
+    server = socket.create_server((host, port))
+    try:
+        while True:
+            conn, _ = server.accept()
+            with conn:
+                conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                try:
+                    GDBServer(AVRDebugger(jtag, **kwargs), conn).run()
+                except ConnectionError:
+                    pass
+            if once:
+                break
+    finally:
+        server.close()
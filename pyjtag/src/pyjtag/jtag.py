@@ -3,9 +3,10 @@
 #
 # Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
 
-import click
 import importlib
-from .util import HexParamType
+from contextlib import contextmanager
+from .bitvector import BitVector
+from .trace import traced
 
 IR_EXTEST               = 0
 IR_IDCODE               = 1
@@ -21,6 +22,11 @@ AVR_IR_PRIVATE3         = 11
 AVR_IR_RESET            = 12
 AVR_IR_BYPASS           = 15
 
+# Flags on the register byte of an avr_ocd_regs entry, an exec entry runs
+# its value as an instruction through PRIVATE2
+OCD_REG_WRITE           = 0x80
+OCD_REG_EXEC            = 0x40
+
 class JTAG:
     STATE_RESET         = 0x00
     STATE_RUNIDLE       = 0x01
@@ -40,25 +46,97 @@ class JTAG:
     STATE_IRUPDATE      = 0x0F
     STATE_UNKNOWN       = 0x10
 
-    def __init__(self, backend='freejtag', *args, **kwargs):
+    def __init__(self, backend='freejtag', *args, trace=None, record=None,
+            tck_delay=None, **kwargs):
         mod = importlib.import_module(f'.{backend}', 'pyjtag.backends')
         self.backend = mod.Backend(*args, **kwargs)
+        if record is not None:
+            self.backend = record.wrap(self.backend)
+        self.trace = trace
+        if trace is not None:
+            self.backend = trace.wrap(self.backend)
+        self.tck_delay = tck_delay
+        # (bits, value) last shifted into the IR, None when unknown
+        self._ir = None
+        self._transactions = 0
 
     def __enter__(self):
         self.backend._acquire()
+        self._ir = None
+        if self.tck_delay is not None:
+            try:
+                # A callable picks the delay once the probe is attached
+                self.set_tck_delay(self.tck_delay(self)
+                        if callable(self.tck_delay) else self.tck_delay)
+            except BaseException:
+                # __exit__ never runs when __enter__ raises
+                self.__exit__(None, None, None)
+                raise
         return self
 
     def __exit__(self, exc_type, exc_val, exc_tb):
-        self.backend._release()
+        try:
+            self.backend._release()
+        finally:
+            # Backends holding their own USB context free it here
+            close = getattr(self.backend, 'close', None)
+            if close is not None:
+                close()
+
+    @contextmanager
+    def transaction(self):
+        """Run a sequence of operations without other daemon clients
+        interleaving, a no-op on directly attached backends."""
+        transaction = getattr(self.backend, 'transaction', None)
+        if transaction is None:
+            yield
+            return
+        with transaction():
+            # Other clients may load the IR whenever we do not hold the TAP
+            if not self._transactions:
+                self._ir = None
+            self._transactions += 1
+            try:
+                yield
+            finally:
+                self._transactions -= 1
+                if not self._transactions:
+                    self._ir = None
+
+    def _cache_ir(self, key):
+        # A shared TAP is only ours while a transaction holds it
+        if self._transactions or not hasattr(self.backend, 'transaction'):
+            self._ir = key
+
+    def invalidate_ir(self):
+        """Forget the cached IR, for callers that drive the backend
+        directly."""
+        self._ir = None
 
     def set_state(self, state):
+        # Every move into the IR column or Test-Logic-Reset can capture or
+        # update the IR, only RUNIDLE and the DR column leave it alone
+        if not (state == self.STATE_RUNIDLE or
+                self.STATE_DRSELECT <= state <= self.STATE_DRUPDATE):
+            self._ir = None
         self.backend.set_state(state)
 
+    def set_tck_delay(self, delay):
+        set_tck_delay = getattr(self.backend, 'set_tck_delay', None)
+        if set_tck_delay is None:
+            raise RuntimeError('This backend has no TCK rate control')
+        set_tck_delay(delay)
+
+    def read_idcode(self):
+        """Read the IDCODE selected by Test-Logic-Reset, no IR scan."""
+        self.set_state(self.STATE_RESET)
+        return self.shift_dr(32, read=True)
+
     def shift(self, bits, exit=True):
         self.backend.shift(bits, exit)
 
     def shift_out(self, bits, value, exit=True):
-        self.backend.shift_out(bits, value, exit=True)
+        self.backend.shift_out(bits, value, exit)
 
     def shift_in(self, bits, exit=True):
         return self.backend.shift_in(bits, exit)
@@ -66,24 +144,35 @@ class JTAG:
     def shift_outin(self, bits, value, exit=True):
         return self.backend.shift_outin(bits, value, exit)
 
-    def shift_ir(self, total_bits, value=None, read=False) -> None | int:
-        result = None
-        self.set_state(JTAG.STATE_IRSHIFT)
-        if value is None and not read:
-           self.shift(total_bits)
-        elif value is not None and not read:
-           self.shift_out(total_bits, value)
-        elif value is None and read:
-           result = self.shift_in(total_bits)
-        elif value is not None and read:
-           result = self.shift_outin(total_bits, value)
-        self.set_state(self.STATE_RUNIDLE)
-        return result
+    def scan(self, bits, tdi=None, tdo=None, exit=True):
+        limit = getattr(self.backend, 'max_scan_bits', None) or bits
+        if limit < bits:
+            limit &= ~7
+        tdi = memoryview(tdi.buf) if tdi is not None else None
+        tdo = memoryview(tdo.buf) if tdo is not None else None
+        pos = 0
+        while pos < bits:
+            n = min(limit, bits - pos)
+            span = slice(pos >> 3, (pos + n + 7) >> 3)
+            self.backend.scan(n, tdi[span] if tdi is not None else None,
+                    tdo[span] if tdo is not None else None,
+                    exit and pos + n == bits)
+            pos += n
 
-    def shift_dr(self, total_bits, value=None, read=False) -> None | int:
+    def _shift_reg(self, state, total_bits, value, read):
         result = None
-        self.set_state(self.STATE_DRSHIFT)
-        if value is None and not read:
+        limit = getattr(self.backend, 'max_scan_bits', None)
+        self.set_state(state)
+        if isinstance(total_bits, BitVector):
+            vector = total_bits
+            self.scan(len(vector), vector, vector if read else None)
+            result = vector if read else None
+        elif limit is not None and total_bits > limit:
+            tdi = BitVector(total_bits, value) if value is not None else None
+            tdo = BitVector(total_bits) if read else None
+            self.scan(total_bits, tdi, tdo)
+            result = tdo.to_int() if read else None
+        elif value is None and not read:
             self.shift(total_bits)
         elif value is not None and not read:
             self.shift_out(total_bits, value)
@@ -94,63 +183,113 @@ class JTAG:
         self.set_state(self.STATE_RUNIDLE)
         return result
 
+    @traced
+    def shift_ir(self, total_bits, value=None, read=False):
+        result = self._shift_reg(self.STATE_IRSHIFT, total_bits, value, read)
+        if isinstance(total_bits, int) and value is not None:
+            self._cache_ir((total_bits, value))
+        return result
+
+    @traced
+    def select_ir(self, total_bits, value):
+        """
+        Load an instruction, skipping the scan when the IR already holds
+        it.  Instructions that act when updated, like the AVR OCD break and
+        resume, must use shift_ir so the update always happens.
+        """
+        if self._ir == (total_bits, value):
+            return
+        self.shift_ir(total_bits, value)
+
+    @traced
+    def shift_dr(self, total_bits, value=None, read=False):
+        return self._shift_reg(self.STATE_DRSHIFT, total_bits, value, read)
+
+    @traced
     def avr_reset(self, state=True):
-        self.shift_ir(4, AVR_IR_RESET)
+        self.select_ir(4, AVR_IR_RESET)
         self.shift_dr(1, state)
 
+    @traced
     def avr_prog_enable(self, state=True):
-        self.shift_ir(4, AVR_IR_PROG_ENABLE)
+        self.select_ir(4, AVR_IR_PROG_ENABLE)
         self.shift_dr(16, 0xa370 if state else 0)
 
+    @traced
     def avr_signature(self):
-        self.shift_ir(4, AVR_IR_PROG_COMMANDS)
         def read_byte(addr):
             self.shift_dr(15, 0b0100011_00001000)
             self.shift_dr(15, 0b0000011_00000000 | (addr & 0xff))
             self.shift_dr(15, 0b0110010_00000000)
             return self.shift_dr(15, 0b0110011_00000000, read=True) & 0xff
-        return bytes(read_byte(addr) for addr in range(3))
+        with self.transaction():
+            self.select_ir(4, AVR_IR_PROG_COMMANDS)
+            return bytes(read_byte(addr) for addr in range(3))
 
+    @traced
     def avr_prog_write(self, addr: int, value: int) -> None:
         addr &= 0xF
         value &= 0xFFFF
 
-        self.shift_ir(4, AVR_IR_PRIVATE3)
+        self.select_ir(4, AVR_IR_PRIVATE3)
         self.shift_dr(5, addr)
         self.shift_dr(21, (1 << 20) | (addr << 16) | value)
 
+    @traced
     def avr_prog_read(self, addr: int) -> int:
         addr &= 0xF
 
-        self.shift_ir(4, AVR_IR_PRIVATE3)
+        self.select_ir(4, AVR_IR_PRIVATE3)
         self.shift_dr(5, addr)
         return self.shift_dr(16, read=True)
 
+    @traced
+    def avr_ocd_regs(self, entries):
+        """
+        Run (register, value) entries against the OCD registers, a value of
+        None reads.  A register of OCD_REG_EXEC executes the value as an
+        instruction on the stopped core instead, so an instruction moving
+        data to OCDR and the OCDR read can share one request.  Returns the
+        values read, in order.  The probe runs the whole list in one
+        request when it can.
+        """
+        entries = list(entries)
+        if hasattr(self.backend, 'avr_ocd_regs') and \
+                getattr(self.backend, 'has_ocd_regs', True):
+            data = bytearray()
+            for reg, value in entries:
+                if reg == OCD_REG_EXEC:
+                    data.append(OCD_REG_EXEC)
+                else:
+                    data.append(reg & 0xF if value is None else
+                            (reg & 0xF) | OCD_REG_WRITE)
+                data += (value or 0).to_bytes(2, 'little')
+            result = self.backend.avr_ocd_regs(bytes(data))
+            if entries:
+                # The probe leaves the last entry's instruction selected
+                self._cache_ir((4, AVR_IR_PRIVATE2
+                        if entries[-1][0] == OCD_REG_EXEC else AVR_IR_PRIVATE3))
+            return [int.from_bytes(result[i:i + 2], 'little')
+                    for i in range(0, len(result), 2)]
+        values = []
+        with self.transaction():
+            for reg, value in entries:
+                if reg == OCD_REG_EXEC:
+                    self.select_ir(4, AVR_IR_PRIVATE2)
+                    self.shift_dr(16, value)
+                elif value is None:
+                    values.append(self.avr_prog_read(reg))
+                else:
+                    self.avr_prog_write(reg, value)
+        return values
+
+    @traced
     def avr_read_ocdr(self):
         if hasattr(self.backend, 'avr_read_ocdr'):
-           return self.backend.avr_read_ocdr()
-        if self.avr_prog_read(0xD) & 0x10:
-            return bytes((self.avr_prog_read(0xC) >> 8,))
-
-@click.command
-@click.option('--backend', default='freejtag')
-@click.option('--vid', type=HexParamType('vid'))
-@click.option('--pid', type=HexParamType('pid'))
-@click.option('--index', type=click.INT)
-def main(backend, **kwargs):
-    with JTAG(backend, **kwargs) as jtag:
-        jtag.shift_ir(4, IR_IDCODE)
-        idcode = jtag.shift_dr(32, read=True)
-        print(f'IDCODE = 0x{idcode:08X}')
-
-        jtag.avr_reset(True)
-        jtag.avr_prog_enable(True)
-
-        signature = jtag.avr_signature()
-        print('Signature: ' + ' '.join(f'{byte:02X}' for byte in signature))
-
-        jtag.avr_prog_enable(False)
-        jtag.avr_reset(False)
-
-if __name__ == '__main__':
-    main()
+            # The probe leaves the OCD registers selected
+            ch = self.backend.avr_read_ocdr()
+            self._cache_ir((4, AVR_IR_PRIVATE3))
+            return ch
+        with self.transaction():
+            if self.avr_prog_read(0xD) & 0x10:
+                return bytes((self.avr_prog_read(0xC) >> 8,))
@@ -0,0 +1,187 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import ctypes
+import ctypes.util
+import os
+
+from ctypes import (POINTER, Structure, byref, c_bool, c_char, c_char_p,
+        c_int, c_int16, c_size_t, c_uint8, c_uint16, c_void_p)
+
+# Register byte flags of an OCD register entry, as in libfreejtag.h
+OCD_WRITE = 0x80
+OCD_EXEC = 0x40
+
+
+class FreeJTAGError(RuntimeError):
+    pass
+
+
+class Segment(Structure):
+    _fields_ = [
+        ('tdi', c_void_p),
+        ('tdi_offset', c_size_t),
+        ('tdo', c_void_p),
+        ('tdo_offset', c_size_t),
+        ('bits', c_size_t),
+    ]
+
+
+def _load():
+    path = os.environ.get('LIBFREEJTAG') or \
+            ctypes.util.find_library('freejtag') or 'libfreejtag.so'
+    lib = ctypes.CDLL(path)
+
+    def proto(name, restype, *argtypes):
+        func = getattr(lib, name)
+        func.restype = restype
+        func.argtypes = argtypes
+
+    proto('freejtag_open', c_int, POINTER(c_void_p), c_uint16, c_uint16, c_int,
+            c_char_p)
+    proto('freejtag_close', None, c_void_p)
+    proto('freejtag_strerror', c_char_p, c_int)
+    proto('freejtag_version', c_int, c_void_p, POINTER(c_uint16))
+    proto('freejtag_arena_size', c_size_t, c_void_p)
+    proto('freejtag_reset', c_int, c_void_p)
+    proto('freejtag_attach', c_int, c_void_p, c_bool)
+    proto('freejtag_set_tdi', c_int, c_void_p, c_bool)
+    proto('freejtag_set_tms', c_int, c_void_p, c_bool)
+    proto('freejtag_set_state', c_int, c_void_p, c_uint8)
+    proto('freejtag_clock', c_int, c_void_p, c_size_t)
+    proto('freejtag_set_tck_delay', c_int, c_void_p, c_uint8)
+    proto('freejtag_shift', c_int, c_void_p, c_size_t, c_bool)
+    proto('freejtag_scan', c_int, c_void_p, c_void_p, c_size_t, c_void_p,
+            c_size_t, c_size_t, c_bool)
+    proto('freejtag_scan_sg', c_int, c_void_p, POINTER(Segment), c_size_t,
+            c_bool)
+    proto('freejtag_bulk_write', c_int, c_void_p, c_void_p, c_size_t)
+    proto('freejtag_bulk_read', c_int, c_void_p, c_void_p, c_size_t)
+    proto('freejtag_avr_read_ocdr', c_int, c_void_p, POINTER(c_int16))
+    proto('freejtag_avr_ocd_regs', c_int, c_void_p, c_void_p, c_size_t,
+            c_void_p)
+    return lib
+
+
+_lib = None
+
+
+def library():
+    global _lib
+    if _lib is None:
+        _lib = _load()
+    return _lib
+
+
+def _check(ret):
+    if ret < 0:
+        raise FreeJTAGError(library().freejtag_strerror(ret).decode())
+
+
+def _buffer(obj, writable=False):
+    """Return (pointer, keepalive) for a bytes-like object without copying."""
+    if obj is None:
+        return None, None
+    view = memoryview(obj).cast('B')
+    if not view.readonly:
+        array = (c_char * len(view)).from_buffer(view)
+        return ctypes.addressof(array), array
+    if writable:
+        raise TypeError('TDO buffer must be writable')
+    if isinstance(obj, bytes):
+        return ctypes.cast(c_char_p(obj), c_void_p).value, obj
+    data = view.tobytes()
+    return ctypes.cast(c_char_p(data), c_void_p).value, data
+
+
+class Device:
+    def __init__(self, vid=0x0403, pid=0x7ba8, index=0, serial=None):
+        self._lib = library()
+        self._dev = c_void_p()
+        _check(self._lib.freejtag_open(byref(self._dev), vid, pid, index,
+                serial.encode() if serial else None))
+
+    def close(self):
+        if self._dev:
+            self._lib.freejtag_close(self._dev)
+            self._dev = c_void_p()
+
+    def __del__(self):
+        self.close()
+
+    def version(self):
+        value = c_uint16()
+        _check(self._lib.freejtag_version(self._dev, byref(value)))
+        return value.value
+
+    def arena_size(self):
+        return self._lib.freejtag_arena_size(self._dev)
+
+    def reset(self):
+        _check(self._lib.freejtag_reset(self._dev))
+
+    def attach(self, attach=True):
+        _check(self._lib.freejtag_attach(self._dev, attach))
+
+    def set_tdi(self, value=True):
+        _check(self._lib.freejtag_set_tdi(self._dev, value))
+
+    def set_tms(self, value=True):
+        _check(self._lib.freejtag_set_tms(self._dev, value))
+
+    def set_state(self, state):
+        _check(self._lib.freejtag_set_state(self._dev, state))
+
+    def clock(self, cycles):
+        _check(self._lib.freejtag_clock(self._dev, cycles))
+
+    def set_tck_delay(self, delay):
+        _check(self._lib.freejtag_set_tck_delay(self._dev, delay))
+
+    def shift(self, bits, exit=True):
+        _check(self._lib.freejtag_shift(self._dev, bits, exit))
+
+    def scan(self, bits, tdi=None, tdo=None, exit=True, tdi_offset=0,
+            tdo_offset=0):
+        tdi_ptr, tdi_keep = _buffer(tdi)
+        tdo_ptr, tdo_keep = _buffer(tdo, writable=True)
+        _check(self._lib.freejtag_scan(self._dev, tdi_ptr, tdi_offset,
+                tdo_ptr, tdo_offset, bits, exit))
+
+    def scan_sg(self, segments, exit=True):
+        """segments: iterable of (tdi, tdi_offset, tdo, tdo_offset, bits)"""
+        segments = list(segments)
+        array = (Segment * len(segments))()
+        keep = []
+        for i, (tdi, tdi_offset, tdo, tdo_offset, bits) in \
+                enumerate(segments):
+            tdi_ptr, tdi_keep = _buffer(tdi)
+            tdo_ptr, tdo_keep = _buffer(tdo, writable=True)
+            keep += [tdi_keep, tdo_keep]
+            array[i] = Segment(tdi_ptr, tdi_offset, tdo_ptr, tdo_offset, bits)
+        _check(self._lib.freejtag_scan_sg(self._dev, array, len(segments),
+                exit))
+
+    def bulk_write(self, data):
+        ptr, keep = _buffer(data)
+        _check(self._lib.freejtag_bulk_write(self._dev, ptr, len(keep)))
+
+    def bulk_read_into(self, buf):
+        ptr, keep = _buffer(buf, writable=True)
+        _check(self._lib.freejtag_bulk_read(self._dev, ptr, len(keep)))
+
+    def avr_read_ocdr(self):
+        value = c_int16()
+        _check(self._lib.freejtag_avr_read_ocdr(self._dev, byref(value)))
+        return value.value
+
+    def avr_ocd_regs(self, entries):
+        """entries: 3 byte OCD register entries, returns the values read"""
+        reads = sum(not reg & (OCD_WRITE | OCD_EXEC) for reg in entries[::3])
+        values = bytearray(reads * 2)
+        entries_ptr, entries_keep = _buffer(entries)
+        values_ptr, values_keep = _buffer(values, writable=True)
+        _check(self._lib.freejtag_avr_ocd_regs(self._dev, entries_ptr,
+                len(entries), values_ptr))
+        return bytes(values)
@@ -0,0 +1,309 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+# AVR on-chip debug over JTAG.
+#
+# Atmel never documented the OCD instructions.  What is used here follows
+# community reverse engineering and has NOT been verified on silicon:
+#
+#   PRIVATE0  select to force a break
+#   PRIVATE1  select to resume, honouring the break control register
+#   PRIVATE2  16-bit DR, capture reads the PC (words), update executes the
+#             shifted instruction while the core is stopped
+#   PRIVATE3  OCD registers, a 5-bit address then 16-bit read or 21-bit
+#             write (bit 20 set), as already used for the OCDR console
+#
+# Every assumption about register addresses and bit positions lives in the
+# constants below so it can be corrected in one place.
+
+from .jtag import (AVR_IR_PRIVATE0, AVR_IR_PRIVATE1, AVR_IR_PRIVATE2,
+        OCD_REG_EXEC)
+
+OCD_PSB0            = 0x0
+OCD_PSB1            = 0x1
+OCD_BCR             = 0x8
+OCD_OCDR            = 0xC
+OCD_CSR             = 0xD
+
+BCR_PSB0            = 0x0100
+BCR_PSB1            = 0x0200
+BCR_STEP            = 0x4000
+
+CSR_STOPPED         = 0x0008
+CSR_OCDR_DIRTY      = 0x0010
+
+IO_SPL              = 0x3D
+IO_SPH              = 0x3E
+IO_SREG             = 0x3F
+
+# GDB's AVR address spaces
+FLASH_BASE          = 0x000000
+SRAM_BASE           = 0x800000
+EEPROM_BASE         = 0x810000
+
+# r0-r31, SREG, SP (2 bytes), PC (4 bytes)
+GDB_REG_SIZES       = (1,) * 33 + (2, 4)
+REG_SREG            = 32
+REG_SP              = 33
+REG_PC              = 34
+
+BLOCK_SIZE          = 64
+SCRATCH             = 16
+
+
+def insn_in(rd, io):
+    return 0xB000 | ((io & 0x30) << 5) | (rd << 4) | (io & 0xF)
+
+
+def insn_out(io, rr):
+    return 0xB800 | ((io & 0x30) << 5) | (rr << 4) | (io & 0xF)
+
+
+def insn_ldi(rd, k):
+    return 0xE000 | ((k & 0xF0) << 4) | ((rd - 16) << 4) | (k & 0xF)
+
+
+def insn_mov(rd, rr):
+    return 0x2C00 | ((rr & 0x10) << 5) | (rd << 4) | (rr & 0xF)
+
+
+def insn_ld_z_inc(rd):
+    return 0x9001 | (rd << 4)
+
+
+def insn_st_z_inc(rr):
+    return 0x9201 | (rr << 4)
+
+
+def insn_lpm_z_inc(rd):
+    return 0x9005 | (rd << 4)
+
+
+INSN_IJMP = 0x9409
+
+
+class AVRDebugger:
+    """
+    Stop/step/run control and register and memory access for one AVR.
+
+    While stopped, registers are read once and memory is read in aligned
+    BLOCK_SIZE blocks, both cached until the core runs again, so GDB
+    walking a stack or an array costs one block read rather than a round
+    trip per byte.  Each value leaves through OCDR, the instructions and
+    OCDR reads go to the probe as one batch.  Registers used as scratch
+    (r16, r30, r31) are restored from the cache before the core resumes.
+    """
+
+    def __init__(self, jtag, ocdr_io=0x31, flash_size=0x8000,
+            sram_end=0x860):
+        self.jtag = jtag
+        self.ocdr_io = ocdr_io
+        self.flash_size = flash_size
+        self.sram_end = sram_end
+        self.breakpoints = [None, None]
+        self._invalidate()
+
+    def _invalidate(self):
+        self._regs = None
+        self._dirty = set()
+        self._blocks = {}
+
+    def _select(self, ir):
+        self.jtag.select_ir(4, ir)
+
+    def _exec(self, *insns):
+        self._select(AVR_IR_PRIVATE2)
+        for insn in insns:
+            self.jtag.shift_dr(16, insn)
+
+    def _fetch(self, *insns):
+        """
+        Run each group of instructions, then read the register it leaves
+        in OCDR, all in one batch.  Returns the bytes read.
+        """
+        entries = []
+        for group in insns:
+            for insn in group:
+                entries.append((OCD_REG_EXEC, insn))
+            entries.append((OCD_OCDR, None))
+        return bytes(value >> 8 for value in self.jtag.avr_ocd_regs(entries))
+
+    def _set_z(self, addr):
+        self.read_registers()
+        self._exec(insn_ldi(30, addr & 0xFF), insn_ldi(31, (addr >> 8) & 0xFF))
+        self._dirty |= {30, 31}
+
+    # Run control
+
+    def status(self):
+        return self.jtag.avr_prog_read(OCD_CSR)
+
+    def stopped(self):
+        return bool(self.status() & CSR_STOPPED)
+
+    def read_console(self):
+        if self.status() & CSR_OCDR_DIRTY:
+            return bytes((self.jtag.avr_prog_read(OCD_OCDR) >> 8,))
+        return b''
+
+    def halt(self):
+        # The break happens on update, so always scan
+        self.jtag.shift_ir(4, AVR_IR_PRIVATE0)
+        self._invalidate()
+
+    def _resume(self, bcr):
+        self._write_back()
+        # Breakpoints and the break control go out as one batch
+        entries = []
+        for i, addr in enumerate(self.breakpoints):
+            if addr is not None:
+                entries.append((OCD_PSB0 + i, addr >> 1))
+                bcr |= (BCR_PSB0, BCR_PSB1)[i]
+        entries.append((OCD_BCR, bcr))
+        self.jtag.avr_ocd_regs(entries)
+        self.jtag.shift_ir(4, AVR_IR_PRIVATE1)
+        self._invalidate()
+
+    def step(self):
+        self._resume(BCR_STEP)
+
+    def cont(self):
+        self._resume(0)
+
+    def add_breakpoint(self, addr):
+        if addr in self.breakpoints:
+            return True
+        if None not in self.breakpoints:
+            return False
+        self.breakpoints[self.breakpoints.index(None)] = addr
+        return True
+
+    def remove_breakpoint(self, addr):
+        if addr in self.breakpoints:
+            self.breakpoints[self.breakpoints.index(addr)] = None
+
+    # Registers
+
+    def read_registers(self):
+        if self._regs is not None:
+            return self._regs
+        self._select(AVR_IR_PRIVATE2)
+        pc = self.jtag.shift_dr(16, read=True)
+
+        groups = [(insn_out(self.ocdr_io, r),) for r in range(32)]
+        for io in (IO_SREG, IO_SPL, IO_SPH):
+            groups.append((insn_in(SCRATCH, io),
+                    insn_out(self.ocdr_io, SCRATCH)))
+        values = list(self._fetch(*groups))
+
+        self._regs = values[:32] + [values[32],
+                values[33] | (values[34] << 8), pc << 1]
+        self._dirty = {SCRATCH}
+        return self._regs
+
+    def write_register(self, index, value):
+        self.read_registers()
+        self._regs[index] = value
+        self._dirty.add(index)
+
+    def _write_back(self):
+        if self._regs is None or not self._dirty:
+            return
+        regs = self._regs
+        if REG_SREG in self._dirty:
+            self._exec(insn_ldi(SCRATCH, regs[REG_SREG]),
+                    insn_out(IO_SREG, SCRATCH))
+        if REG_SP in self._dirty:
+            self._exec(insn_ldi(SCRATCH, regs[REG_SP] & 0xFF),
+                    insn_out(IO_SPL, SCRATCH),
+                    insn_ldi(SCRATCH, regs[REG_SP] >> 8),
+                    insn_out(IO_SPH, SCRATCH))
+        if REG_PC in self._dirty:
+            pc = regs[REG_PC] >> 1
+            self._exec(insn_ldi(30, pc & 0xFF), insn_ldi(31, pc >> 8),
+                    INSN_IJMP)
+            self._dirty |= {30, 31}
+        for r in sorted(r for r in self._dirty if r < 16):
+            self._exec(insn_ldi(SCRATCH, regs[r]), insn_mov(r, SCRATCH))
+            self._dirty.add(SCRATCH)
+        for r in sorted(r for r in self._dirty if 16 <= r < 32):
+            self._exec(insn_ldi(r, regs[r]))
+        self._dirty.clear()
+
+    # Memory
+
+    def _read_block(self, space, base, length):
+        self._set_z(base)
+        self._dirty.add(SCRATCH)
+        load = insn_lpm_z_inc if space == FLASH_BASE else insn_ld_z_inc
+        group = (load(SCRATCH), insn_out(self.ocdr_io, SCRATCH))
+        return self._fetch(*[group] * length)
+
+    def _cached_read(self, space, addr, length, floor, limit):
+        data = bytearray()
+        end = min(addr + length, limit)
+        while addr < end:
+            # Blocks stay aligned, only the one holding the floor is cut
+            aligned = addr - addr % BLOCK_SIZE
+            base = max(aligned, floor)
+            block = self._blocks.get((space, base))
+            if block is None:
+                # Read ahead the whole aligned block, GDB usually asks
+                # for its neighbours next
+                block = self._read_block(space, base,
+                        min(aligned + BLOCK_SIZE, limit) - base)
+                self._blocks[(space, base)] = block
+            n = min(end, base + len(block)) - addr
+            data += block[addr - base:addr - base + n]
+            addr += n
+        return bytes(data)
+
+    def read_memory(self, addr, length):
+        regs = self.read_registers()
+        if addr >= EEPROM_BASE:
+            raise ValueError('EEPROM access is not supported')
+        if addr < SRAM_BASE:
+            return self._cached_read(FLASH_BASE, addr, length, 0,
+                    self.flash_size)
+
+        addr -= SRAM_BASE
+        data = bytearray()
+        while length > 0 and addr < self.sram_end:
+            if addr < 32:
+                data.append(regs[addr])
+                addr += 1
+                length -= 1
+            elif addr < 0x60:
+                # I/O registers can have read side effects, so no read-ahead
+                n = min(length, 0x60 - addr)
+                data += self._read_block(SRAM_BASE, addr, n)
+                addr += n
+                length -= n
+            else:
+                chunk = self._cached_read(SRAM_BASE, addr, length, 0x60,
+                        self.sram_end)
+                data += chunk
+                addr += len(chunk)
+                length -= len(chunk)
+        return bytes(data)
+
+    def write_memory(self, addr, data):
+        if not SRAM_BASE <= addr < EEPROM_BASE:
+            raise ValueError('Only SRAM can be written')
+        addr -= SRAM_BASE
+        self.read_registers()
+        for i, byte in enumerate(data):
+            if addr + i < 32:
+                self.write_register(addr + i, byte)
+        start = max(addr, 32)
+        data = data[start - addr:]
+        if data:
+            self._set_z(start)
+            for byte in data:
+                self._exec(insn_ldi(SCRATCH, byte), insn_st_z_inc(SCRATCH))
+            self._dirty.add(SCRATCH)
+        for key in [key for key in self._blocks if key[0] == SRAM_BASE and
+                key[1] < start + len(data) and
+                key[1] + len(self._blocks[key]) > start]:
+            del self._blocks[key]
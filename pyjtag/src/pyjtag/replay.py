@@ -0,0 +1,310 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+from functools import wraps
+from time import perf_counter
+
+MAGIC = b'FJTL'
+VERSION = 1
+
+# Argument and result types:
+#   b: bool, u: unsigned varint, y: length-prefixed bytes,
+#   o: optional bytes (length + 1, 0 meaning None), v: version tuple,
+#   t: output buffer flag, the buffer contents are logged as the result
+#
+# opcode: (name, ((arg, type, default), ...), result type)
+OPS = {
+    0x01: ('_acquire', (), None),
+    0x02: ('_release', (), None),
+    0x03: ('version', (), 'v'),
+    0x04: ('set_tdi', (('value', 'b', True),), None),
+    0x05: ('set_tms', (('value', 'b', True),), None),
+    0x06: ('set_state', (('state', 'u', None),), None),
+    0x07: ('clock', (('cycles', 'u', None),), None),
+    0x08: ('shift', (('bits', 'u', None), ('exit', 'b', True)), None),
+    0x09: ('shift_out', (('bits', 'u', None), ('value', 'u', None),
+                         ('exit', 'b', True)), None),
+    0x0A: ('shift_in', (('bits', 'u', None), ('exit', 'b', True)), 'u'),
+    0x0B: ('shift_outin', (('bits', 'u', None), ('value', 'u', None),
+                           ('exit', 'b', True)), 'u'),
+    0x0C: ('bulk_write_bytes', (('data', 'y', None),), None),
+    0x0D: ('bulk_read_bytes', (('count', 'u', None),), 'y'),
+    0x0E: ('avr_read_ocdr', (), 'o'),
+    0x0F: ('scan', (('bits', 'u', None), ('tdi', 'o', None),
+                    ('tdo', 't', None), ('exit', 'b', True)), 'o'),
+    0x10: ('xsvf_write', (('data', 'y', None), ('start', 'b', False)), None),
+    0x11: ('xsvf_status', (), 'v'),
+    0x12: ('set_tck_delay', (('delay', 'u', None),), None),
+    0x13: ('avr_ocd_regs', (('data', 'y', None),), 'y'),
+}
+
+OPTIONAL_ARGS = {'o', 't'}
+
+OPCODES = {name: (opcode, args, result)
+           for opcode, (name, args, result) in OPS.items()}
+
+
+class ReplayError(Exception):
+    pass
+
+
+def encode_varint(value, out):
+    if value < 0:
+        raise ValueError('Negative values cannot be logged')
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return
+
+
+def decode_varint(buf, pos):
+    value = shift = 0
+    while True:
+        try:
+            byte = buf[pos]
+        except IndexError:
+            raise ReplayError('Truncated log')
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def encode_value(kind, value, out):
+    if kind == 't':
+        out.append(0 if value is None else 1)
+    elif kind == 'b':
+        out.append(1 if value else 0)
+    elif kind == 'u':
+        encode_varint(int(value), out)
+    elif kind == 'y':
+        encode_varint(len(value), out)
+        out += value
+    elif kind == 'o':
+        if value is None:
+            out.append(0)
+        else:
+            encode_varint(len(value) + 1, out)
+            out += value
+    elif kind == 'v':
+        for part in value:
+            encode_varint(part, out)
+
+
+def decode_value(kind, buf, pos):
+    if kind in 'bt':
+        if pos >= len(buf):
+            raise ReplayError('Truncated log')
+        return bool(buf[pos]), pos + 1
+    if kind == 'u':
+        return decode_varint(buf, pos)
+    if kind in 'yo':
+        length, pos = decode_varint(buf, pos)
+        if kind == 'o':
+            if not length:
+                return None, pos
+            length -= 1
+        if pos + length > len(buf):
+            raise ReplayError('Truncated log')
+        return bytes(buf[pos:pos + length]), pos + length
+    if kind == 'v':
+        parts = []
+        for _ in range(3):
+            part, pos = decode_varint(buf, pos)
+            parts.append(part)
+        return tuple(parts), pos
+    raise ValueError(f'Unknown value type {kind!r}')
+
+
+def bind_args(spec, args, kwargs):
+    values = []
+    for i, (name, kind, default) in enumerate(spec):
+        if i < len(args):
+            value = args[i]
+        elif name in kwargs:
+            value = kwargs[name]
+        elif default is not None or kind in OPTIONAL_ARGS:
+            value = default
+        else:
+            raise TypeError(f'Missing argument {name!r}')
+        values.append(value)
+    return values
+
+
+def snapshot(spec, values):
+    # Scans may overwrite TDI in place, so capture it before the call
+    return [bytes(value) if kind in 'oy' and value is not None else value
+            for (_, kind, _), value in zip(spec, values)]
+
+
+def encode_args(name, args, out):
+    opcode, spec, _ = OPCODES[name]
+    out.append(opcode)
+    for (_, kind, _), value in zip(spec, args):
+        encode_value(kind, value, out)
+
+
+def encode_call(name, args, result, out):
+    encode_args(name, args, out)
+    result_kind = OPCODES[name][2]
+    if result_kind:
+        encode_value(result_kind, result, out)
+
+
+def decode_args(buf, pos):
+    opcode = buf[pos]
+    try:
+        name, spec, _ = OPS[opcode]
+    except KeyError:
+        raise ReplayError(f'Unknown opcode 0x{opcode:02X} at offset {pos}')
+    pos += 1
+    args = []
+    for _, kind, _ in spec:
+        value, pos = decode_value(kind, buf, pos)
+        args.append(value)
+    return name, tuple(args), pos
+
+
+def decode_calls(buf, pos=0):
+    while pos < len(buf):
+        name, args, pos = decode_args(buf, pos)
+        result = None
+        result_kind = OPCODES[name][2]
+        if result_kind:
+            result, pos = decode_value(result_kind, buf, pos)
+        yield name, args, result
+
+
+class Recorder:
+    def __init__(self, path):
+        self._file = open(path, 'wb')
+        self._file.write(MAGIC + bytes((VERSION,)))
+        self._buf = bytearray()
+
+    def wrap(self, backend):
+        return RecordingBackend(self, backend)
+
+    def _write(self, name, args, result):
+        encode_call(name, args, result, self._buf)
+        if len(self._buf) >= 4096:
+            self.flush()
+
+    def flush(self):
+        self._file.write(self._buf)
+        self._buf.clear()
+
+    def close(self):
+        if self._file.closed:
+            return
+        self.flush()
+        self._file.close()
+
+
+class RecordingBackend:
+    def __init__(self, recorder, backend):
+        self._recorder = recorder
+        self._backend = backend
+
+    def __getattr__(self, name):
+        # Deferred results cannot be logged in call order, so make callers
+        # fall back to the synchronous API while recording.
+        if name.endswith('_deferred'):
+            raise AttributeError(name)
+
+        attr = getattr(self._backend, name)
+        if name not in OPCODES or not callable(attr):
+            return attr
+
+        spec = OPCODES[name][1]
+
+        @wraps(attr)
+        def wrapper(*args, **kwargs):
+            values = bind_args(spec, args, kwargs)
+            logged = snapshot(spec, values)
+            result = attr(*values)
+            self._recorder._write(name, logged,
+                    output_buffers(spec, values, result))
+            return result
+        return wrapper
+
+
+def output_buffers(spec, values, result):
+    for (_, kind, _), value in zip(spec, values):
+        if kind == 't':
+            if value is None:
+                return None
+            return bytes(value[:(values[0] + 7) // 8])
+    return result
+
+
+def call(backend, name, args):
+    spec = OPCODES[name][1]
+    args = [bytearray((args[0] + 7) // 8) if kind == 't' and value else
+            None if kind == 't' else value
+            for (_, kind, _), value in zip(spec, args)]
+    return output_buffers(spec, args, getattr(backend, name)(*args))
+
+
+def load(path):
+    with open(path, 'rb') as f:
+        buf = f.read()
+    if len(buf) < len(MAGIC) + 1 or buf[:4] != MAGIC:
+        raise ReplayError('Not a FreeJTAG session log')
+    if buf[4] != VERSION:
+        raise ReplayError(f'Unsupported log version {buf[4]}')
+    return list(decode_calls(buf, 5))
+
+
+class Mismatch:
+    def __init__(self, index, name, args, expected, actual):
+        self.index = index
+        self.name = name
+        self.args = args
+        self.expected = expected
+        self.actual = actual
+
+    def __str__(self):
+        return (f'#{self.index} {self.name}{self.args}: '
+                f'expected {self.expected!r}, got {self.actual!r}')
+
+
+class ReplayResult:
+    def __init__(self):
+        self.calls = 0
+        self.bits = 0
+        self.elapsed = 0.0
+        self.mismatches = []
+
+    def __str__(self):
+        rate = self.calls / self.elapsed if self.elapsed else 0
+        return (f'{self.calls} calls, {self.bits} bits in '
+                f'{self.elapsed * 1000:.1f} ms ({rate:.0f} calls/s), '
+                f'{len(self.mismatches)} mismatches')
+
+
+def replay(backend, calls, check=True, stop=False, skip_attach=False):
+    result = ReplayResult()
+    start = perf_counter()
+    for index, (name, args, expected) in enumerate(calls):
+        if skip_attach and name in ('_acquire', '_release'):
+            continue
+        actual = call(backend, name, args)
+        if isinstance(expected, bytes) and actual is not None:
+            actual = bytes(actual)
+        result.calls += 1
+        if name in ('clock', 'shift', 'shift_out', 'shift_in', 'shift_outin',
+                'scan'):
+            result.bits += args[0]
+        if check and OPCODES[name][2] and actual != expected:
+            result.mismatches.append(
+                    Mismatch(index, name, args, expected, actual))
+            if stop:
+                break
+    result.elapsed = perf_counter() - start
+    return result
@@ -0,0 +1,331 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import re
+from time import perf_counter, sleep
+
+from .bitvector import BitVector
+from .jtag import JTAG
+from .tap import set_state_supported
+
+STATES = {
+    'RESET':        JTAG.STATE_RESET,
+    'IDLE':         JTAG.STATE_RUNIDLE,
+    'DRSELECT':     JTAG.STATE_DRSELECT,
+    'DRCAPTURE':    JTAG.STATE_DRCAPTURE,
+    'DRSHIFT':      JTAG.STATE_DRSHIFT,
+    'DREXIT1':      JTAG.STATE_DREXIT1,
+    'DRPAUSE':      JTAG.STATE_DRPAUSE,
+    'DREXIT2':      JTAG.STATE_DREXIT2,
+    'DRUPDATE':     JTAG.STATE_DRUPDATE,
+    'IRSELECT':     JTAG.STATE_IRSELECT,
+    'IRCAPTURE':    JTAG.STATE_IRCAPTURE,
+    'IRSHIFT':      JTAG.STATE_IRSHIFT,
+    'IREXIT1':      JTAG.STATE_IREXIT1,
+    'IRPAUSE':      JTAG.STATE_IRPAUSE,
+    'IREXIT2':      JTAG.STATE_IREXIT2,
+    'IRUPDATE':     JTAG.STATE_IRUPDATE,
+}
+
+STABLE_STATES = (JTAG.STATE_RESET, JTAG.STATE_RUNIDLE, JTAG.STATE_DRPAUSE,
+        JTAG.STATE_IRPAUSE)
+
+COMMENT_RE = re.compile(r'(!|//).*')
+HEX_RE = re.compile(r'\(([^)]*)\)')
+
+
+class SVFError(Exception):
+    def __init__(self, line, message):
+        super().__init__(f'line {line}: {message}')
+        self.line = line
+
+
+def statements(lines):
+    """Yield (line number, tokens) for each statement, reading lazily."""
+    parts = []
+    start = None
+    for number, line in enumerate(lines, 1):
+        line = COMMENT_RE.sub('', line)
+        while True:
+            text, sep, line = line.partition(';')
+            if start is None and text.strip():
+                start = number
+            parts.append(text)
+            if not sep:
+                break
+            text = ' '.join(parts)
+            parts = []
+            if start is not None:
+                # Hex strings may be split across lines
+                text = HEX_RE.sub(lambda m: ' (' + ''.join(m.group(1).split())
+                        + ') ', text)
+                yield start, text.upper().split()
+            start = None
+    if start is not None:
+        raise SVFError(start, 'Missing ; at end of file')
+
+
+class Register:
+    """Sticky SIR/SDR/HIR/HDR/TIR/TDR parameters."""
+
+    def __init__(self, tdi_ones=False):
+        self.tdi_ones = tdi_ones
+        self.length = 0
+        self.tdi = 0
+        self.mask = 0
+        self.smask = 0
+        self.tdo = None
+
+    def update(self, line, tokens):
+        try:
+            length = int(tokens[1])
+        except (IndexError, ValueError):
+            raise SVFError(line, f'{tokens[0]} needs a length')
+        fields = {}
+        args = tokens[2:]
+        if len(args) % 2:
+            raise SVFError(line, f'Malformed {tokens[0]}')
+        for name, value in zip(args[::2], args[1::2]):
+            if name not in ('TDI', 'TDO', 'MASK', 'SMASK') or \
+                    not value.startswith('('):
+                raise SVFError(line, f'Malformed {tokens[0]} field {name}')
+            try:
+                fields[name] = int(value[1:-1] or '0', 16) & \
+                        ((1 << length) - 1)
+            except ValueError:
+                raise SVFError(line, f'Bad hex in {tokens[0]} {name}')
+
+        ones = (1 << length) - 1
+        if length != self.length:
+            # TDI, MASK and SMASK only carry over at the same length
+            if 'TDI' not in fields and length and tokens[0] in ('SIR', 'SDR'):
+                raise SVFError(line, f'{tokens[0]} length changed without TDI')
+            self.length = length
+            self.tdi = ones if self.tdi_ones else 0
+            self.mask = ones
+            self.smask = ones
+        self.tdi = fields.get('TDI', self.tdi)
+        self.mask = fields.get('MASK', self.mask)
+        self.smask = fields.get('SMASK', self.smask)
+        self.tdo = fields.get('TDO')
+
+
+class SVFResult:
+    def __init__(self):
+        self.statements = 0
+        self.scans = 0
+        self.bits = 0
+        self.checks = 0
+        self.skipped_states = 0
+        self.merged_runtests = 0
+        self.elapsed = 0.0
+
+    def __str__(self):
+        elapsed = self.elapsed or float('inf')
+        return (f'{self.statements} statements, {self.scans} scans, '
+                f'{self.bits} bits, {self.checks} TDO checks in '
+                f'{self.elapsed * 1000:.1f} ms '
+                f'({self.bits / elapsed / 1000:.1f} kbit/s), '
+                f'{self.skipped_states} state moves skipped, '
+                f'{self.merged_runtests} RUNTESTs merged')
+
+
+class Player:
+    """
+    Streaming SVF player.
+
+    Rather than one backend call per SVF construct, header, body and
+    trailer are merged into a single scan, back to back RUNTESTs in the
+    same state become one clock run, moves to the state the TAP is already
+    in are dropped, and TDO checks are queued on the backend's deferred
+    reads and checked in batches so the probe is never idle waiting for
+    the host to compare.
+    """
+
+    def __init__(self, jtag, batch=64):
+        self.jtag = jtag
+        self.backend = jtag.backend
+        self.batch = batch
+        self.deferred = getattr(self.backend, 'shift_outin_deferred', None)
+        self.deferred_bits = getattr(self.backend, 'max_scan_bits', None) or 0
+        self.state = None
+        self.sir = Register()
+        self.sdr = Register()
+        self.hir = Register(tdi_ones=True)
+        self.tir = Register(tdi_ones=True)
+        self.hdr = Register()
+        self.tdr = Register()
+        self.endir = JTAG.STATE_RUNIDLE
+        self.enddr = JTAG.STATE_RUNIDLE
+        self.run_state = JTAG.STATE_RUNIDLE
+        self.end_state = JTAG.STATE_RUNIDLE
+        self.clocks = 0
+        self.pending = []
+        self.result = SVFResult()
+
+    def _state(self, line, name):
+        try:
+            return STATES[name]
+        except KeyError:
+            raise SVFError(line, f'Unknown state {name}')
+
+    def _stable(self, line, name):
+        state = self._state(line, name)
+        if state not in STABLE_STATES:
+            raise SVFError(line, f'{name} is not a stable state')
+        return state
+
+    def _flush_clocks(self):
+        while self.clocks:
+            cycles = min(self.clocks, 256)
+            self.backend.clock(cycles)
+            self.clocks -= cycles
+
+    def _goto(self, line, state):
+        if state == self.state:
+            self.result.skipped_states += 1
+            return
+        self._flush_clocks()
+        if self.state is not None and \
+                not set_state_supported(self.state, state):
+            # The probe ignores moves it has no sequence for, Run-Test/Idle
+            # reaches every stable state
+            if not set_state_supported(self.state, JTAG.STATE_RUNIDLE) or \
+                    not set_state_supported(JTAG.STATE_RUNIDLE, state):
+                name = next(k for k, v in STATES.items() if v == state)
+                raise SVFError(line, f'The probe cannot move to {name}')
+            self.jtag.set_state(JTAG.STATE_RUNIDLE)
+        self.jtag.set_state(state)
+        self.state = state
+
+    def _compare(self, line, value, tdo, mask, bits):
+        self.result.checks += 1
+        if (value ^ tdo) & mask:
+            width = (bits + 3) // 4
+            raise SVFError(line, f'TDO mismatch, read 0x{value:0{width}X}, '
+                    f'expected 0x{tdo:0{width}X} mask 0x{mask:0{width}X}')
+
+    def check(self):
+        """Compare every queued TDO read."""
+        pending, self.pending = self.pending, []
+        for line, read, tdo, mask, bits in pending:
+            self._compare(line, read.result(), tdo, mask, bits)
+
+    def _scan(self, line, ir):
+        if ir:
+            regs = (self.hir, self.sir, self.tir)
+            shift, end = JTAG.STATE_IRSHIFT, self.endir
+        else:
+            regs = (self.hdr, self.sdr, self.tdr)
+            shift, end = JTAG.STATE_DRSHIFT, self.enddr
+
+        bits = tdi = tdo = mask = 0
+        check = False
+        for reg in regs:
+            tdi |= reg.tdi << bits
+            if reg.tdo is not None:
+                tdo |= reg.tdo << bits
+                mask |= reg.mask << bits
+                check = True
+            bits += reg.length
+        if not bits:
+            return
+
+        self._goto(line, shift)
+        if not check:
+            self.jtag.scan(bits, BitVector(bits, tdi))
+        elif self.deferred and bits <= self.deferred_bits:
+            self.pending.append((line, self.deferred(bits, tdi), tdo, mask,
+                    bits))
+            if len(self.pending) >= self.batch:
+                self.check()
+        else:
+            read = BitVector(bits)
+            self.jtag.scan(bits, BitVector(bits, tdi), read)
+            self._compare(line, read.to_int(), tdo, mask, bits)
+        self.state = JTAG.STATE_IREXIT1 if ir else JTAG.STATE_DREXIT1
+        self._goto(line, end)
+        self.result.scans += 1
+        self.result.bits += bits
+
+    def _runtest(self, line, args):
+        run_state = end_state = None
+        if args and args[0] in STATES:
+            run_state = self._stable(line, args.pop(0))
+        cycles = 0
+        min_time = 0.0
+        try:
+            if len(args) >= 2 and args[1] in ('TCK', 'SCK'):
+                # No system clock on this probe, SCK is counted as TCK
+                cycles = int(float(args.pop(0)))
+                args.pop(0)
+            if len(args) >= 2 and args[1] == 'SEC':
+                min_time = float(args.pop(0))
+                args.pop(0)
+            if len(args) >= 3 and args[0] == 'MAXIMUM':
+                del args[:3]
+            if len(args) == 2 and args[0] == 'ENDSTATE':
+                end_state = self._stable(line, args.pop(1))
+                args.pop(0)
+        except ValueError:
+            raise SVFError(line, 'Malformed RUNTEST')
+        if args:
+            raise SVFError(line, 'Malformed RUNTEST')
+
+        if run_state is not None:
+            self.run_state = run_state
+            self.end_state = run_state
+        if end_state is not None:
+            self.end_state = end_state
+
+        if self.clocks and self.state == self.run_state:
+            self.result.merged_runtests += 1
+        self._goto(line, self.run_state)
+        self.clocks += cycles
+        if min_time:
+            self._flush_clocks()
+            self.check()
+            flush = getattr(self.backend, 'flush', None)
+            if flush:
+                flush()
+            sleep(min_time)
+        self._goto(line, self.end_state)
+
+    def execute(self, line, tokens):
+        cmd, args = tokens[0], tokens[1:]
+        self.result.statements += 1
+        if cmd in ('SIR', 'SDR', 'HIR', 'HDR', 'TIR', 'TDR'):
+            getattr(self, cmd.lower()).update(line, tokens)
+            if cmd in ('SIR', 'SDR'):
+                self._scan(line, cmd == 'SIR')
+        elif cmd in ('ENDIR', 'ENDDR'):
+            if len(args) != 1:
+                raise SVFError(line, f'Malformed {cmd}')
+            setattr(self, cmd.lower(), self._stable(line, args[0]))
+        elif cmd == 'RUNTEST':
+            self._runtest(line, args)
+        elif cmd == 'STATE':
+            if not args:
+                raise SVFError(line, 'STATE needs a state')
+            for name in args:
+                self._goto(line, self._state(line, name))
+        elif cmd in ('FREQUENCY', 'TRST'):
+            # TCK speed is fixed by the probe and there is no TRST pin
+            pass
+        else:
+            raise SVFError(line, f'Unsupported command {cmd}')
+
+    def play(self, lines):
+        start = perf_counter()
+        for line, tokens in statements(lines):
+            self.execute(line, tokens)
+        self._flush_clocks()
+        self.check()
+        self.result.elapsed = perf_counter() - start
+        return self.result
+
+
+def play(jtag, path, batch=64):
+    with open(path) as f:
+        return Player(jtag, batch).play(f)
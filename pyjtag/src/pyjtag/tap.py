@@ -0,0 +1,79 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+from collections import deque
+
+from .jtag import JTAG
+
+# (next state if TMS=0, next state if TMS=1)
+TAP_NEXT = {
+    JTAG.STATE_RESET:       (JTAG.STATE_RUNIDLE,    JTAG.STATE_RESET),
+    JTAG.STATE_RUNIDLE:     (JTAG.STATE_RUNIDLE,    JTAG.STATE_DRSELECT),
+    JTAG.STATE_DRSELECT:    (JTAG.STATE_DRCAPTURE,  JTAG.STATE_IRSELECT),
+    JTAG.STATE_DRCAPTURE:   (JTAG.STATE_DRSHIFT,    JTAG.STATE_DREXIT1),
+    JTAG.STATE_DRSHIFT:     (JTAG.STATE_DRSHIFT,    JTAG.STATE_DREXIT1),
+    JTAG.STATE_DREXIT1:     (JTAG.STATE_DRPAUSE,    JTAG.STATE_DRUPDATE),
+    JTAG.STATE_DRPAUSE:     (JTAG.STATE_DRPAUSE,    JTAG.STATE_DREXIT2),
+    JTAG.STATE_DREXIT2:     (JTAG.STATE_DRSHIFT,    JTAG.STATE_DRUPDATE),
+    JTAG.STATE_DRUPDATE:    (JTAG.STATE_RUNIDLE,    JTAG.STATE_DRSELECT),
+    JTAG.STATE_IRSELECT:    (JTAG.STATE_IRCAPTURE,  JTAG.STATE_RESET),
+    JTAG.STATE_IRCAPTURE:   (JTAG.STATE_IRSHIFT,    JTAG.STATE_IREXIT1),
+    JTAG.STATE_IRSHIFT:     (JTAG.STATE_IRSHIFT,    JTAG.STATE_IREXIT1),
+    JTAG.STATE_IREXIT1:     (JTAG.STATE_IRPAUSE,    JTAG.STATE_IRUPDATE),
+    JTAG.STATE_IRPAUSE:     (JTAG.STATE_IRPAUSE,    JTAG.STATE_IREXIT2),
+    JTAG.STATE_IREXIT2:     (JTAG.STATE_IRSHIFT,    JTAG.STATE_IRUPDATE),
+    JTAG.STATE_IRUPDATE:    (JTAG.STATE_RUNIDLE,    JTAG.STATE_DRSELECT),
+}
+
+# States the firmware's Set State can move from, by target.  It always
+# takes the shortest path, and ignores any other move without touching
+# the TAP.  Test-Logic-Reset is reachable from anywhere.
+SET_STATE_FROM = {
+    JTAG.STATE_RUNIDLE:     (JTAG.STATE_RESET, JTAG.STATE_DRPAUSE,
+                             JTAG.STATE_IRPAUSE, JTAG.STATE_DREXIT1,
+                             JTAG.STATE_DREXIT2, JTAG.STATE_IREXIT1,
+                             JTAG.STATE_IREXIT2, JTAG.STATE_DRUPDATE,
+                             JTAG.STATE_IRUPDATE),
+    JTAG.STATE_DRSHIFT:     (JTAG.STATE_RESET, JTAG.STATE_RUNIDLE,
+                             JTAG.STATE_DRUPDATE, JTAG.STATE_IRUPDATE,
+                             JTAG.STATE_DRPAUSE, JTAG.STATE_DREXIT2,
+                             JTAG.STATE_IRPAUSE, JTAG.STATE_IREXIT1,
+                             JTAG.STATE_IREXIT2),
+    JTAG.STATE_DRPAUSE:     (JTAG.STATE_RESET, JTAG.STATE_RUNIDLE,
+                             JTAG.STATE_DRUPDATE, JTAG.STATE_IRUPDATE,
+                             JTAG.STATE_DREXIT1, JTAG.STATE_IREXIT1,
+                             JTAG.STATE_IREXIT2),
+    JTAG.STATE_DRUPDATE:    (JTAG.STATE_DREXIT1, JTAG.STATE_DREXIT2),
+    JTAG.STATE_IRSHIFT:     (JTAG.STATE_RESET, JTAG.STATE_RUNIDLE,
+                             JTAG.STATE_DRUPDATE, JTAG.STATE_IRUPDATE,
+                             JTAG.STATE_IRPAUSE, JTAG.STATE_IREXIT2,
+                             JTAG.STATE_DRPAUSE, JTAG.STATE_DREXIT1,
+                             JTAG.STATE_DREXIT2),
+    JTAG.STATE_IRPAUSE:     (JTAG.STATE_RESET, JTAG.STATE_RUNIDLE,
+                             JTAG.STATE_DRUPDATE, JTAG.STATE_IRUPDATE,
+                             JTAG.STATE_IREXIT1, JTAG.STATE_DREXIT1,
+                             JTAG.STATE_DREXIT2),
+    JTAG.STATE_IRUPDATE:    (JTAG.STATE_IREXIT1, JTAG.STATE_IREXIT2),
+}
+
+
+def set_state_supported(src, dst):
+    return dst == JTAG.STATE_RESET or src in SET_STATE_FROM.get(dst, ())
+
+
+def tap_path(src, dst):
+    if src == dst:
+        return ()
+    paths = {src: ()}
+    queue = deque((src,))
+    while queue:
+        state = queue.popleft()
+        for tms, next_state in enumerate(TAP_NEXT[state]):
+            if next_state in paths:
+                continue
+            paths[next_state] = paths[state] + (tms,)
+            if next_state == dst:
+                return paths[next_state]
+            queue.append(next_state)
+    raise ValueError('Unreachable TAP state')
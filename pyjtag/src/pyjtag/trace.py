@@ -0,0 +1,257 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import json
+from contextlib import contextmanager
+from functools import wraps
+from time import perf_counter_ns
+
+
+STATE_NAMES = (
+    'RESET', 'RUNIDLE', 'DRSELECT', 'DRCAPTURE', 'DRSHIFT', 'DREXIT1',
+    'DRPAUSE', 'DREXIT2', 'DRUPDATE', 'IRSELECT', 'IRCAPTURE', 'IRSHIFT',
+    'IREXIT1', 'IRPAUSE', 'IREXIT2', 'IRUPDATE', 'UNKNOWN',
+)
+
+
+def _state_name(state):
+    if state is None or not 0 <= state < len(STATE_NAMES):
+        return 'UNKNOWN'
+    return STATE_NAMES[state]
+
+
+def _nbytes(bits):
+    return (bits + 7) // 8
+
+
+def _arg(args, index):
+    return args[index] if len(args) > index else None
+
+
+def _ocd_reads(data):
+    # Entries without OCD_REG_WRITE or OCD_REG_EXEC return 2 bytes
+    return sum(not reg & 0xC0 for reg in data[::3])
+
+
+# name -> (kind, bits(args), bytes out(args), bytes in(args))
+BACKEND_OPS = {
+    'version':          ('control', None, lambda a: 0, lambda a: 2),
+    'set_tdi':          ('pin', None, None, None),
+    'set_tms':          ('pin', None, None, None),
+    'set_state':        ('state', None, None, None),
+    'clock':            ('clock', lambda a: a[0], None, None),
+    'set_tck_delay':    ('control', None, None, None),
+    'shift':            ('shift', lambda a: a[0], None, None),
+    'shift_out':        ('out', lambda a: a[0], lambda a: _nbytes(a[0]), None),
+    'shift_in':         ('in', lambda a: a[0], None, lambda a: _nbytes(a[0])),
+    'shift_outin':      ('outin', lambda a: a[0], lambda a: _nbytes(a[0]),
+                         lambda a: _nbytes(a[0])),
+    'shift_in_deferred':
+                        ('in', lambda a: a[0], None, lambda a: _nbytes(a[0])),
+    'shift_outin_deferred':
+                        ('outin', lambda a: a[0], lambda a: _nbytes(a[0]),
+                         lambda a: _nbytes(a[0])),
+    'scan':             ('scan', lambda a: a[0],
+                         lambda a: _nbytes(a[0]) if _arg(a, 1) is not None
+                                 else 0,
+                         lambda a: _nbytes(a[0]) if _arg(a, 2) is not None
+                                 else 0),
+    'bulk_write_bytes': ('bulk', lambda a: len(a[0]) * 8, lambda a: len(a[0]),
+                         None),
+    'bulk_read_bytes':  ('bulk', lambda a: a[0] * 8, None, lambda a: a[0]),
+    'avr_read_ocdr':    ('ocd', None, None, lambda a: 2),
+    'avr_ocd_regs':     ('ocd', None, lambda a: len(a[0]),
+                         lambda a: 2 * _ocd_reads(a[0])),
+    'xsvf_write':       ('xsvf', None, lambda a: len(a[0]), None),
+    'xsvf_status':      ('control', None, None, lambda a: 6),
+}
+
+
+class Histogram:
+    def __init__(self):
+        self.count = 0
+        self.total = 0
+        self.min = None
+        self.max = None
+        self.buckets = {}
+
+    def add(self, ns):
+        self.count += 1
+        self.total += ns
+        self.min = ns if self.min is None else min(self.min, ns)
+        self.max = ns if self.max is None else max(self.max, ns)
+        bucket = max(ns // 1000, 1).bit_length() - 1
+        self.buckets[bucket] = self.buckets.get(bucket, 0) + 1
+
+    @property
+    def mean(self):
+        return self.total / self.count if self.count else 0
+
+    def to_dict(self):
+        return {
+            'count': self.count,
+            'total_us': self.total / 1000,
+            'min_us': (self.min or 0) / 1000,
+            'mean_us': self.mean / 1000,
+            'max_us': (self.max or 0) / 1000,
+            'buckets_us': {1 << b: n for b, n in sorted(self.buckets.items())},
+        }
+
+    def format(self, name, width=40):
+        lines = [f'{name}: n={self.count} mean={self.mean / 1000:.1f}us '
+                 f'min={(self.min or 0) / 1000:.1f}us '
+                 f'max={(self.max or 0) / 1000:.1f}us']
+        peak = max(self.buckets.values(), default=0)
+        for bucket, n in sorted(self.buckets.items()):
+            bar = '#' * max(1, n * width // peak)
+            lines.append(f'  {1 << bucket:>8}us {n:>8} {bar}')
+        return '\n'.join(lines)
+
+
+class Event:
+    __slots__ = ('name', 'cat', 'start', 'end', 'depth', 'root', 'args')
+
+    def __init__(self, name, cat, start, depth, root, args):
+        self.name = name
+        self.cat = cat
+        self.start = start
+        self.end = start
+        self.depth = depth
+        self.root = root
+        self.args = args
+
+    @property
+    def duration(self):
+        return self.end - self.start
+
+
+class Trace:
+    def __init__(self):
+        self.events = []
+        self._stack = []
+        self._epoch = perf_counter_ns()
+
+    def wrap(self, backend):
+        return TracedBackend(self, backend)
+
+    def _begin(self, name, cat, args):
+        root = self._stack[0].name if self._stack else None
+        event = Event(name, cat, perf_counter_ns() - self._epoch,
+                len(self._stack), root, args)
+        self._stack.append(event)
+        return event
+
+    def _end(self, event):
+        event.end = perf_counter_ns() - self._epoch
+        self._stack.pop()
+        self.events.append(event)
+
+    @contextmanager
+    def span(self, name, cat='jtag', **args):
+        event = self._begin(name, cat, args)
+        try:
+            yield event
+        finally:
+            self._end(event)
+
+    def to_chrome(self):
+        events = []
+        for event in sorted(self.events, key=lambda e: (e.start, e.depth)):
+            events.append({
+                'name': event.name,
+                'cat': event.cat,
+                'ph': 'X',
+                'ts': event.start / 1000,
+                'dur': event.duration / 1000,
+                'pid': 1,
+                'tid': 1,
+                'args': event.args,
+            })
+        return {'traceEvents': events, 'displayTimeUnit': 'ns'}
+
+    def save_chrome(self, path):
+        with open(path, 'w') as f:
+            json.dump(self.to_chrome(), f)
+
+    def histograms(self, cat='backend'):
+        result = {}
+        for event in self.events:
+            if event.cat != cat:
+                continue
+            name = event.name
+            if event.args.get('kind') in ('shift', 'out', 'in', 'outin', 'scan'):
+                name = f'{name}[{event.args["state"]}]'
+            result.setdefault(name, Histogram()).add(event.duration)
+        return result
+
+    def summary(self):
+        roots = {}
+        for event in self.events:
+            if event.depth == 0:
+                name = event.name if event.cat != 'backend' else '(direct)'
+                row = roots.setdefault(name, [0, 0, 0, 0, 0])
+                row[0] += 1
+                row[1] += event.duration
+            if event.cat == 'backend':
+                name = event.root or '(direct)'
+                row = roots.setdefault(name, [0, 0, 0, 0, 0])
+                row[2] += 1
+                row[3] += event.args.get('transfers', 0)
+                row[4] += event.args.get('bytes', 0)
+
+        lines = [f'{"call":<24} {"count":>8} {"total ms":>10} {"ops":>8} '
+                 f'{"xfers":>8} {"xfers/call":>10} {"bytes":>8}']
+        for name, (count, total, ops, xfers, nbytes) in sorted(
+                roots.items(), key=lambda kv: -kv[1][1]):
+            per_call = xfers / count if count else 0
+            lines.append(f'{name:<24} {count:>8} {total / 1e6:>10.3f} '
+                         f'{ops:>8} {xfers:>8} {per_call:>10.1f} {nbytes:>8}')
+        lines.append('')
+        for name, histogram in sorted(self.histograms().items()):
+            lines.append(histogram.format(name))
+        return '\n'.join(lines)
+
+
+class TracedBackend:
+    def __init__(self, trace, backend):
+        self._trace = trace
+        self._backend = backend
+        self._state = None
+
+    def __getattr__(self, name):
+        attr = getattr(self._backend, name)
+        if name not in BACKEND_OPS or not callable(attr):
+            return attr
+
+        kind, bits, bytes_out, bytes_in = BACKEND_OPS[name]
+
+        @wraps(attr)
+        def wrapper(*args, **kwargs):
+            if name == 'set_state':
+                self._state = args[0]
+            op = {'kind': kind, 'state': _state_name(self._state)}
+            if bits:
+                op['bits'] = bits(args)
+            op['bytes'] = (bytes_out(args) if bytes_out else 0) + \
+                    (bytes_in(args) if bytes_in else 0)
+            transfers = getattr(self._backend, 'transfers', None)
+            event = self._trace._begin(name, 'backend', op)
+            try:
+                return attr(*args, **kwargs)
+            finally:
+                if transfers is not None:
+                    op['transfers'] = self._backend.transfers - transfers
+                self._trace._end(event)
+        return wrapper
+
+
+def traced(func):
+    @wraps(func)
+    def wrapper(self, *args, **kwargs):
+        trace = self.trace
+        if trace is None:
+            return func(self, *args, **kwargs)
+        with trace.span(func.__name__):
+            return func(self, *args, **kwargs)
+    return wrapper
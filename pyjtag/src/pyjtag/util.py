@@ -19,3 +19,17 @@ class HexParamType(click.ParamType):
             return int(value, 16)
         except ValueError:
             self.fail(f"{value!r} is not a valid {self.name}", param, ctx)
+
+
+def parse_backend_options(options):
+    kwargs = {}
+    for option in options:
+        key, sep, value = option.partition('=')
+        if not sep:
+            raise click.BadParameter(f'{option!r} is not KEY=VALUE',
+                    param_hint='--option')
+        try:
+            kwargs[key] = int(value, 0)
+        except ValueError:
+            kwargs[key] = value
+    return kwargs
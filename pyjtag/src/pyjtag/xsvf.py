@@ -0,0 +1,224 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+from time import sleep
+
+from .bitvector import BitVector
+from .jtag import JTAG
+
+XCOMPLETE           = 0x00
+XTDOMASK            = 0x01
+XSIR                = 0x02
+XSDR                = 0x03
+XRUNTEST            = 0x04
+XREPEAT             = 0x07
+XSDRSIZE            = 0x08
+XSDRTDO             = 0x09
+XSTATE              = 0x12
+XENDIR              = 0x13
+XENDDR              = 0x14
+XSIR2               = 0x15
+XCOMMENT            = 0x16
+XWAIT               = 0x17
+
+STATUS_READY        = 0
+STATUS_COMPLETE     = 1
+STATUS_TDOMISMATCH  = 2
+STATUS_ILLEGALCMD   = 3
+STATUS_ILLEGALSTATE = 4
+STATUS_DATAOVERFLOW = 5
+
+STATUS_NAMES = ('ready', 'complete', 'TDO mismatch', 'illegal command',
+        'illegal state', 'data overflow')
+
+
+class XSVFError(Exception):
+    def __init__(self, status, cmd, offset):
+        super().__init__(f'XSVF {STATUS_NAMES[status]} in command '
+                f'0x{cmd:02X} at offset {offset}')
+        self.status = status
+        self.cmd = cmd
+        self.offset = offset
+
+
+def play_device(backend, data, chunk=1024):
+    """
+    Stream the file to the probe's own player.  Each control transfer is
+    parsed and clocked out by the firmware as it arrives, so the host only
+    checks the status once per chunk instead of waiting on every scan.
+    """
+    # Like the host player, an empty stream just leaves the player ready
+    status = STATUS_READY
+    for pos in range(0, len(data), chunk):
+        backend.xsvf_write(data[pos:pos + chunk], start=pos == 0)
+        status, cmd, offset = backend.xsvf_status()
+        if status == STATUS_COMPLETE:
+            break
+        if status != STATUS_READY:
+            raise XSVFError(status, cmd, offset)
+    return status
+
+
+class Player:
+    """Host side player with the same semantics, for any backend."""
+
+    def __init__(self, jtag):
+        self.jtag = jtag
+        self.data = b''
+        self.pos = 0
+        self.sdr_bits = 0
+        self.tdo = BitVector()
+        self.mask = BitVector()
+        self.runtest = 0
+        self.repeat = 32
+        self.endir = JTAG.STATE_RUNIDLE
+        self.enddr = JTAG.STATE_RUNIDLE
+
+    def _scalar(self, size):
+        value = int.from_bytes(self.data[self.pos:self.pos + size], 'big')
+        self.pos += size
+        return value
+
+    def _vector(self, bits):
+        size = (bits + 7) // 8
+        value = int.from_bytes(self.data[self.pos:self.pos + size], 'big')
+        self.pos += size
+        return BitVector(bits, value)
+
+    def _goto(self, state, cmd, offset):
+        if state > JTAG.STATE_IRUPDATE:
+            raise XSVFError(STATUS_ILLEGALSTATE, cmd, offset)
+        self.jtag.set_state(state)
+
+    def _wait(self, usecs):
+        if usecs:
+            self.jtag.backend.clock(min(usecs, 256))
+            sleep(usecs / 1000000)
+
+    def _shift_ir(self, bits, tdi):
+        self.jtag.set_state(JTAG.STATE_IRSHIFT)
+        self.jtag.scan(bits, tdi)
+        self.jtag.set_state(self.endir)
+        self._wait(self.runtest)
+
+    def _shift_dr(self, tdi, cmd, offset):
+        runtest = self.runtest
+        self.jtag.set_state(JTAG.STATE_DRSHIFT)
+        for attempt in range(self.repeat + 1):
+            tdo = BitVector(self.sdr_bits)
+            self.jtag.scan(self.sdr_bits, tdi, tdo)
+            if self._match(tdo):
+                break
+            if attempt == self.repeat:
+                raise XSVFError(STATUS_TDOMISMATCH, cmd, offset)
+            # Xilinx's retry: back through Pause-DR, then out through
+            # Update-DR to wait 25% longer in Run-Test/Idle, and capture
+            # again on the way to Shift-DR
+            self.jtag.set_state(JTAG.STATE_DRPAUSE)
+            self.jtag.set_state(JTAG.STATE_DRSHIFT)
+            self.jtag.shift(1)
+            self.jtag.set_state(JTAG.STATE_RUNIDLE)
+            runtest += runtest >> 2
+            self._wait(runtest)
+            self.jtag.set_state(JTAG.STATE_DRSHIFT)
+        self.jtag.set_state(self.enddr)
+        self._wait(runtest)
+
+    def _match(self, tdo):
+        return all(not (a ^ b) & m for a, b, m in
+                zip(tdo.buf, self.tdo.buf, self.mask.buf))
+
+    def play(self, data):
+        self.data = data
+        self.pos = 0
+        while self.pos < len(data):
+            offset = self.pos
+            cmd = data[self.pos]
+            self.pos += 1
+            if cmd == XCOMPLETE:
+                return STATUS_COMPLETE
+            elif cmd == XTDOMASK:
+                self.mask = self._vector(self.sdr_bits)
+            elif cmd in (XSIR, XSIR2):
+                bits = self._scalar(1 if cmd == XSIR else 2)
+                self._shift_ir(bits, self._vector(bits))
+            elif cmd == XSDR:
+                self._shift_dr(self._vector(self.sdr_bits), cmd, offset)
+            elif cmd == XSDRTDO:
+                tdi = self._vector(self.sdr_bits)
+                self.tdo = self._vector(self.sdr_bits)
+                self._shift_dr(tdi, cmd, offset)
+            elif cmd == XRUNTEST:
+                self.runtest = self._scalar(4)
+            elif cmd == XREPEAT:
+                self.repeat = self._scalar(1)
+            elif cmd == XSDRSIZE:
+                self.sdr_bits = self._scalar(4)
+                self.tdo = BitVector(self.sdr_bits, self.tdo.buf)
+                self.mask = BitVector(self.sdr_bits, self.mask.buf)
+            elif cmd == XSTATE:
+                self._goto(self._scalar(1), cmd, offset)
+            elif cmd == XENDIR:
+                self.endir = JTAG.STATE_IRPAUSE if self._scalar(1) else \
+                        JTAG.STATE_RUNIDLE
+            elif cmd == XENDDR:
+                self.enddr = JTAG.STATE_DRPAUSE if self._scalar(1) else \
+                        JTAG.STATE_RUNIDLE
+            elif cmd == XCOMMENT:
+                end = data.find(b'\0', self.pos)
+                self.pos = len(data) if end < 0 else end + 1
+            elif cmd == XWAIT:
+                wait_state, end_state = self._scalar(1), self._scalar(1)
+                usecs = self._scalar(4)
+                self._goto(wait_state, cmd, offset)
+                self._wait(usecs)
+                self._goto(end_state, cmd, offset)
+            else:
+                raise XSVFError(STATUS_ILLEGALCMD, cmd, offset)
+        return STATUS_READY
+
+
+def max_vector_bits(data):
+    """Longest IR or DR vector in the file, to decide if the probe can play it."""
+    longest = pos = 0
+    sizes = {XTDOMASK: 1, XSDR: 1, XSDRTDO: 2}
+    sdr_bytes = 0
+    while pos < len(data):
+        cmd = data[pos]
+        pos += 1
+        if cmd == XSDRSIZE:
+            bits = int.from_bytes(data[pos:pos + 4], 'big')
+            longest = max(longest, bits)
+            sdr_bytes = (bits + 7) // 8
+            pos += 4
+        elif cmd in sizes:
+            pos += sizes[cmd] * sdr_bytes
+        elif cmd in (XSIR, XSIR2):
+            n = 1 if cmd == XSIR else 2
+            bits = int.from_bytes(data[pos:pos + n], 'big')
+            longest = max(longest, bits)
+            pos += n + (bits + 7) // 8
+        elif cmd == XRUNTEST:
+            pos += 4
+        elif cmd in (XREPEAT, XSTATE, XENDIR, XENDDR):
+            pos += 1
+        elif cmd == XWAIT:
+            pos += 6
+        elif cmd == XCOMMENT:
+            end = data.find(b'\0', pos)
+            pos = len(data) if end < 0 else end + 1
+        else:
+            break
+    return longest
+
+
+def play(jtag, data, chunk=1024):
+    """Play on the probe when it can, otherwise from the host."""
+    limit = getattr(jtag.backend, 'xsvf_max_bits', None) or 0
+    if hasattr(jtag.backend, 'xsvf_write') and limit and \
+            max_vector_bits(data) <= limit:
+        # The probe scans the IR behind the host's back
+        jtag.invalidate_ir()
+        return play_device(jtag.backend, data, chunk)
+    return Player(jtag).play(data)
@@ -0,0 +1,17 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import pytest
+
+from pyjtag.calibrate import calibrate
+from pyjtag.jtag import JTAG
+
+
+@pytest.mark.parametrize('min_tck_delay,selected', [(10, 32), (0, 1)])
+def test_backs_off_one_step(min_tck_delay, selected):
+    with JTAG('sim', min_tck_delay=min_tck_delay) as jtag:
+        calibration = calibrate(jtag, rounds=2)
+        assert calibration.delay == selected
+        assert jtag.backend.tck_delay == selected
+
@@ -0,0 +1,40 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import socket
+
+import pytest
+
+from pyjtag.daemon import Server
+
+
+def bound_socket(path, listen):
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.bind(str(path))
+    if listen:
+        sock.listen()
+    return sock
+
+
+def test_stale_socket_is_removed(tmp_path):
+    path = tmp_path / 'pyjtag.sock'
+    bound_socket(path, False).close()
+    Server(None, str(path))._remove_stale()
+    assert not path.exists()
+
+
+def test_live_socket_is_kept(tmp_path):
+    path = tmp_path / 'pyjtag.sock'
+    with bound_socket(path, True):
+        with pytest.raises(RuntimeError):
+            Server(None, str(path))._remove_stale()
+        assert path.exists()
+
+
+def test_other_file_is_kept(tmp_path):
+    path = tmp_path / 'pyjtag.sock'
+    path.write_text('not a socket')
+    with pytest.raises(RuntimeError):
+        Server(None, str(path))._remove_stale()
+    assert path.read_text() == 'not a socket'
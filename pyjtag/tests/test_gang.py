@@ -0,0 +1,88 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import pytest
+
+from pyjtag import gang
+from pyjtag.backends import sim
+from pyjtag.bitvector import BitVector
+from pyjtag.jtag import JTAG, AVR_IR_BYPASS
+from pyjtag.replay import Recorder, load
+
+BOARDS = 4
+
+
+@pytest.fixture
+def serials():
+    return gang.get_serials('sim', count=BOARDS)
+
+
+@pytest.fixture
+def bad_board(monkeypatch):
+    """SIM1 carries a different part than the rest of the gang"""
+    init = sim.Backend.__init__
+
+    def patched(self, **kwargs):
+        if kwargs.get('serial') == 'SIM1':
+            kwargs['idcode'] = 0x12345679
+        init(self, **kwargs)
+    monkeypatch.setattr(sim.Backend, '__init__', patched)
+
+
+@pytest.fixture
+def calls(tmp_path):
+    path = tmp_path / 'session.fjl'
+    recorder = Recorder(path)
+    with JTAG('sim', record=recorder) as jtag:
+        jtag.read_idcode()
+        jtag.avr_prog_enable()
+        jtag.avr_signature()
+        jtag.shift_ir(4, AVR_IR_BYPASS)
+        jtag.shift_dr(BitVector(300, 0x5A5A), read=True)
+    recorder.close()
+    return load(path)
+
+
+def test_serials(serials):
+    assert serials == ('SIM0', 'SIM1', 'SIM2', 'SIM3')
+
+
+def test_identify(serials):
+    result = gang.run('sim', serials, gang.IdentifyJob(0x8950203F),
+            count=BOARDS)
+    assert [board.serial for board in result.boards] == list(serials)
+    assert not result.failed
+    for board in result.boards:
+        assert board.detail == 'IDCODE 0x8950203F, signature 1E 95 02'
+    assert str(result).startswith('4/4 passed')
+
+
+def test_identify_failing_board(serials, bad_board):
+    result = gang.run('sim', serials, gang.IdentifyJob(0x8950203F),
+            count=BOARDS)
+    assert [board.serial for board in result.failed] == ['SIM1']
+    assert result.boards[1].detail.startswith('IDCODE 0x12345679')
+    assert str(result).startswith('3/4 passed')
+
+
+def test_replay(serials, calls):
+    result = gang.run('sim', serials, gang.ReplayJob(calls), count=BOARDS)
+    assert not result.failed
+    assert all(board.bits == result.boards[0].bits > 0
+            for board in result.boards)
+
+
+def test_replay_failing_board(serials, calls, bad_board):
+    result = gang.run('sim', serials, gang.ReplayJob(calls), count=BOARDS)
+    assert [board.serial for board in result.failed] == ['SIM1']
+    assert 'first #' in result.boards[1].detail
+    assert all(board.passed for board in result.boards if board is not
+            result.boards[1])
+
+
+def test_missing_board():
+    result = gang.run('sim', ('SIM0', 'SIM7'), gang.IdentifyJob(),
+            count=2)
+    assert [board.serial for board in result.failed] == ['SIM7']
+    assert result.boards[1].detail == 'Invalid FreeJTAG device serial'
@@ -0,0 +1,24 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import pytest
+
+from pyjtag.jtag import JTAG, AVR_IR_PRIVATE3
+from pyjtag.ocd import OCD_PSB0
+
+
+@pytest.fixture
+def jtag():
+    with JTAG('sim') as jtag:
+        yield jtag
+
+
+def test_ir_cache(jtag):
+    jtag.avr_prog_write(OCD_PSB0, 0x1234)
+    assert jtag._ir == (4, AVR_IR_PRIVATE3)
+    # Pausing in the IR column leaves whatever was shifted in the IR
+    jtag.set_state(JTAG.STATE_IRPAUSE)
+    assert jtag._ir is None
+    jtag.set_state(JTAG.STATE_RUNIDLE)
+    assert jtag.avr_prog_read(OCD_PSB0) == 0x1234
@@ -0,0 +1,69 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import pytest
+
+from pyjtag.jtag import JTAG
+from pyjtag.ocd import AVRDebugger
+
+
+@pytest.fixture
+def jtag():
+    with JTAG('sim', console=b'hi') as jtag:
+        yield jtag
+
+
+@pytest.fixture
+def debugger(jtag):
+    core = jtag.backend.target.core
+    core.data[0:32] = bytes(range(100, 132))
+    core.data[0x100:0x110] = b'0123456789abcdef'
+    core.pc = 0x123
+    debugger = AVRDebugger(jtag)
+    debugger.halt()
+    return debugger
+
+
+def test_console(jtag):
+    assert jtag.avr_read_ocdr() == b'h'
+    assert jtag.avr_read_ocdr() == b'i'
+    assert jtag.avr_read_ocdr() is None
+
+
+def test_registers(debugger, jtag):
+    regs = debugger.read_registers()
+    assert regs[:32] == list(range(100, 132))
+    assert regs[34] == 0x123 << 1
+    debugger.write_register(16, 0xFF)
+    debugger.cont()
+    assert jtag.backend.target.core.data[16] == 0xFF
+
+
+def test_memory(debugger):
+    assert debugger.read_memory(0x800100, 8) == b'01234567'
+    debugger.write_memory(0x800104, b'AB')
+    assert debugger.read_memory(0x800100, 8) == b'0123AB67'
+
+
+def test_blocks_stay_aligned(debugger):
+    debugger.read_memory(0x800070, 0x40)
+    assert sorted(base for _, base in debugger._blocks) == [0x60, 0x80]
+    assert [len(block) for block in debugger._blocks.values()] == [0x20, 0x40]
+
+
+def test_registers_in_one_batch(debugger, jtag):
+    transfers = jtag.backend.transfers
+    debugger.read_registers()
+    # A handful for the PC read and one batch, not several per register
+    assert jtag.backend.transfers - transfers < 10
+
+
+def test_step_and_breakpoint(debugger):
+    debugger.step()
+    assert debugger.stopped()
+    assert debugger.read_registers()[34] == 0x124 << 1
+    assert debugger.add_breakpoint(0x200)
+    debugger.cont()
+    assert debugger.stopped()
+    assert debugger.read_registers()[34] == 0x200
@@ -0,0 +1,57 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import pytest
+
+from pyjtag.jtag import JTAG, AVR_IR_PRIVATE3, OCD_REG_EXEC
+from pyjtag.ocd import OCD_BCR, OCD_OCDR, OCD_PSB0
+
+
+class Plain:
+    """A backend without the batched OCD register request."""
+
+    def __init__(self, backend):
+        self._backend = backend
+
+    def __getattr__(self, name):
+        if name == 'avr_ocd_regs':
+            raise AttributeError(name)
+        return getattr(self._backend, name)
+
+
+@pytest.fixture
+def jtag():
+    with JTAG('sim') as jtag:
+        yield jtag
+
+
+def test_ocd_regs(jtag):
+    values = jtag.avr_ocd_regs([(OCD_PSB0, 0x1234), (OCD_PSB0, None),
+            (OCD_BCR, 0x55), (OCD_BCR, None)])
+    assert values == [0x1234, 0x55]
+
+
+def test_ocd_regs_fallback(jtag):
+    jtag.backend = Plain(jtag.backend)
+    assert jtag.avr_ocd_regs([(OCD_PSB0, 0x4321), (OCD_PSB0, None)]) == \
+            [0x4321]
+
+
+def test_exec_entries(jtag):
+    core = jtag.backend.target.core
+    core.halted = True
+    core.data[5] = 0x42
+    # out OCDR, r5 moves r5 where the next entry reads it
+    values = jtag.avr_ocd_regs([(OCD_REG_EXEC, 0xBE51), (OCD_OCDR, None)])
+    assert values == [0x4200]
+    assert jtag._ir == (4, AVR_IR_PRIVATE3)
+
+
+def test_exec_entries_fallback(jtag):
+    core = jtag.backend.target.core
+    core.halted = True
+    core.data[5] = 0x42
+    jtag.backend = Plain(jtag.backend)
+    values = jtag.avr_ocd_regs([(OCD_REG_EXEC, 0xBE51), (OCD_OCDR, None)])
+    assert values == [0x4200]
@@ -0,0 +1,57 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import importlib
+
+import pytest
+
+from pyjtag.bitvector import BitVector
+from pyjtag.jtag import JTAG, AVR_IR_BYPASS
+from pyjtag.replay import MAGIC, Recorder, ReplayError, load, replay
+
+
+def sim(**kwargs):
+    return importlib.import_module('pyjtag.backends.sim').Backend(**kwargs)
+
+
+@pytest.fixture
+def log(tmp_path):
+    path = tmp_path / 'session.fjl'
+    recorder = Recorder(path)
+    with JTAG('sim', record=recorder) as jtag:
+        jtag.read_idcode()
+        jtag.avr_prog_enable()
+        jtag.avr_signature()
+        jtag.shift_ir(4, AVR_IR_BYPASS)
+        vector = BitVector(300, 0x5A5A)
+        jtag.shift_dr(vector, read=True)
+    recorder.close()
+    return path
+
+
+def test_replay_matches(log):
+    calls = load(log)
+    assert calls[0][0] == '_acquire'
+    result = replay(sim(), calls)
+    assert not result.mismatches
+    assert result.calls == len(calls)
+
+
+def test_replay_reports_mismatch(log):
+    result = replay(sim(idcode=0x12345679), load(log))
+    assert result.mismatches
+    assert result.mismatches[0].expected == 0x8950203F
+
+
+def test_replay_stop(log):
+    result = replay(sim(signature=b'\x1e\x00\x00'), load(log), stop=True)
+    assert len(result.mismatches) == 1
+
+
+@pytest.mark.parametrize('header', [b'', MAGIC[:2], MAGIC, b'XXXX\x01'])
+def test_load_rejects_bad_header(tmp_path, header):
+    path = tmp_path / 'bad.fjl'
+    path.write_bytes(header)
+    with pytest.raises(ReplayError):
+        load(path)
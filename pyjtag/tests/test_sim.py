@@ -0,0 +1,60 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import pytest
+
+from pyjtag.jtag import JTAG
+from pyjtag.tap import SET_STATE_FROM
+
+
+@pytest.fixture
+def jtag():
+    with JTAG('sim') as jtag:
+        yield jtag
+
+
+def place(backend, state):
+    backend._state = state
+    backend.tap.state = state
+
+
+def test_idcode(jtag):
+    assert jtag.read_idcode() == 0x8950203F
+
+
+@pytest.mark.parametrize('src,dst', [(src, dst)
+        for dst, sources in SET_STATE_FROM.items() for src in sources])
+def test_supported_moves(jtag, src, dst):
+    place(jtag.backend, src)
+    jtag.set_state(dst)
+    assert jtag.backend.tap.state == dst
+    assert jtag.backend._state == dst
+
+
+def test_unsupported_move_is_ignored(jtag):
+    jtag.set_state(JTAG.STATE_IRPAUSE)
+    jtag.set_state(JTAG.STATE_DRPAUSE)
+    assert jtag.backend.tap.state == JTAG.STATE_IRPAUSE
+    assert jtag.backend._state == JTAG.STATE_IRPAUSE
+
+
+def test_only_reset_leaves_unknown(jtag):
+    backend = jtag.backend
+    backend._state = JTAG.STATE_UNKNOWN
+    backend.set_state(JTAG.STATE_RUNIDLE)
+    assert backend._state == JTAG.STATE_UNKNOWN
+    backend.set_state(JTAG.STATE_RESET)
+    backend.set_state(JTAG.STATE_RUNIDLE)
+    assert backend.tap.state == JTAG.STATE_RUNIDLE
+
+
+def test_enter_releases_on_failure(monkeypatch):
+    released = []
+    jtag = JTAG('sim', tck_delay=lambda jtag: 1 // 0)
+    monkeypatch.setattr(jtag.backend, '_release',
+            lambda: released.append(True))
+    with pytest.raises(ZeroDivisionError):
+        with jtag:
+            pass
+    assert released == [True]
@@ -0,0 +1,84 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import io
+
+import pytest
+
+from pyjtag.jtag import JTAG
+from pyjtag.svf import Player, SVFError, statements
+
+IDCODE_SVF = """! read the IDCODE twice
+TRST OFF;
+ENDIR IDLE;
+ENDDR IDLE;
+STATE RESET;
+STATE IDLE;
+SIR 4 TDI (1);
+SDR 32 TDI (00000000) TDO (8950203F) MASK (FFFFFFFF);
+SDR 32 TDO (8950203F);
+RUNTEST 10 TCK;
+RUNTEST 20 TCK;
+"""
+
+
+class Deferred:
+    def __init__(self, value):
+        self.value = value
+
+    def result(self):
+        return self.value
+
+
+@pytest.fixture
+def jtag():
+    with JTAG('sim') as jtag:
+        yield jtag
+
+
+def play(jtag, text, **kwargs):
+    return Player(jtag, **kwargs).play(io.StringIO(text))
+
+
+def test_statements_join_lines():
+    parsed = list(statements(io.StringIO('SDR 8 TDI (1\n2);\n// c\nSTATE IDLE;')))
+    assert parsed == [(1, ['SDR', '8', 'TDI', '(12)']), (4, ['STATE', 'IDLE'])]
+
+
+def test_idcode(jtag):
+    result = play(jtag, IDCODE_SVF)
+    assert result.checks == 2
+    assert result.scans == 3
+    assert result.merged_runtests == 1
+
+
+def test_mismatch_reports_line(jtag):
+    with pytest.raises(SVFError) as e:
+        play(jtag, IDCODE_SVF + 'SDR 32 TDO (\n8950203E);\n')
+    assert e.value.line == 12
+
+
+def test_deferred_checks(jtag):
+    backend = jtag.backend
+    backend.shift_outin_deferred = lambda bits, value: \
+            Deferred(backend.shift_outin(bits, value))
+    assert play(jtag, IDCODE_SVF, batch=1).checks == 2
+    with pytest.raises(SVFError):
+        play(jtag, IDCODE_SVF + 'SDR 32 TDO (0);\n', batch=8)
+
+
+def test_routes_unsupported_move(jtag):
+    play(jtag, 'ENDIR IRPAUSE;\nSIR 4 TDI (1);\nSTATE DRPAUSE;\n')
+    assert jtag.backend.tap.state == JTAG.STATE_DRPAUSE
+
+
+def test_rejects_impossible_move(jtag):
+    with pytest.raises(SVFError) as e:
+        play(jtag, 'STATE IDLE DRSELECT;\n')
+    assert e.value.line == 1
+
+
+def test_unsupported_command(jtag):
+    with pytest.raises(SVFError):
+        play(jtag, 'PIO (HL);\n')
@@ -0,0 +1,298 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+# The USB backends against a fake probe.  pyusb and libusb1 are replaced by
+# just enough of their API when they are not installed.
+
+import importlib
+import sys
+import types
+from collections import deque
+
+import pytest
+
+from pyjtag import xsvf
+from pyjtag.jtag import JTAG
+from pyjtag.libfreejtag import FreeJTAGError
+from pyjtag.ocd import OCD_BCR
+
+REQ_ARENA = 0x05
+REQ_XSVF = 0x81
+REQ_OCDREGS = 0x82
+TRANSFER_COMPLETED = 0
+TRANSFER_STALL = 4
+
+
+class USBError(Exception):
+    pass
+
+
+def fake_usb():
+    usb = types.ModuleType('usb')
+    usb.core = types.ModuleType('usb.core')
+    usb.core.USBError = USBError
+    usb.core.Device = usb.core.Interface = object
+    usb.util = types.ModuleType('usb.util')
+    usb.util.CTRL_OUT, usb.util.CTRL_IN = 0x00, 0x80
+    usb.util.CTRL_TYPE_VENDOR = 0x40
+    usb.util.CTRL_RECIPIENT_INTERFACE = 0x01
+    usb.util.build_request_type = lambda d, t, r: d | t | r
+    usb.util.claim_interface = usb.util.release_interface = \
+            lambda device, intf: None
+    return usb
+
+
+def fake_usb1():
+    usb1 = types.ModuleType('usb1')
+    usb1.TYPE_VENDOR, usb1.RECIPIENT_INTERFACE = 0x40, 0x01
+    usb1.ENDPOINT_OUT, usb1.ENDPOINT_IN = 0x00, 0x80
+    usb1.TRANSFER_COMPLETED = TRANSFER_COMPLETED
+    usb1.USBError = USBError
+    return usb1
+
+
+@pytest.fixture
+def backends(monkeypatch):
+    for name, fake in (('usb', fake_usb), ('usb1', fake_usb1)):
+        try:
+            importlib.import_module(name)
+        except ImportError:
+            module = fake()
+            monkeypatch.setitem(sys.modules, name, module)
+            for sub in ('core', 'util'):
+                if hasattr(module, sub):
+                    monkeypatch.setitem(sys.modules, f'{name}.{sub}',
+                            getattr(module, sub))
+    for name in ('pyjtag.backends.freejtag', 'pyjtag.backends.libusb'):
+        monkeypatch.delitem(sys.modules, name, raising=False)
+    freejtag = importlib.import_module('pyjtag.backends.freejtag')
+    libusb = importlib.import_module('pyjtag.backends.libusb')
+    monkeypatch.setattr(freejtag.usb.util, 'claim_interface',
+            lambda device, intf: None)
+    monkeypatch.setattr(freejtag.usb.util, 'release_interface',
+            lambda device, intf: None)
+    return freejtag, libusb
+
+
+class Probe:
+    """Firmware that answers IN requests with zeros and stalls `stalls`."""
+
+    def __init__(self, stalls=()):
+        self.stalls = set(stalls)
+        self.requests = []
+
+    def request(self, bmRequestType, bRequest, wLength):
+        self.requests.append(bRequest)
+        if bRequest in self.stalls:
+            return None
+        if bRequest == REQ_ARENA:
+            return (64).to_bytes(2, 'little')
+        return bytes(wLength) if bmRequestType & 0x80 else b''
+
+
+class PyUSBDevice:
+    def __init__(self, probe, usb):
+        self.probe = probe
+        self.usb = usb
+
+    def ctrl_transfer(self, bmRequestType, bRequest, wValue, wIndex,
+            data_or_wLength=None, timeout=None):
+        wLength = data_or_wLength if bmRequestType & 0x80 else 0
+        data = self.probe.request(bmRequestType, bRequest, wLength)
+        if data is None:
+            raise self.usb.core.USBError('Pipe error')
+        return data
+
+
+class Transfer:
+    def __init__(self, probe):
+        self.probe = probe
+        self.submitted = False
+
+    def setControl(self, bmRequestType, bRequest, wValue, wIndex, data,
+            callback, timeout):
+        self.request = bmRequestType, bRequest, \
+                data if isinstance(data, int) else 0
+        self.callback = callback
+
+    def submit(self):
+        self.submitted = True
+
+    def complete(self):
+        self.buffer = self.probe.request(*self.request)
+        self.submitted = False
+        self.callback(self)
+
+    def isSubmitted(self):
+        return self.submitted
+
+    def getStatus(self):
+        return TRANSFER_STALL if self.buffer is None else TRANSFER_COMPLETED
+
+    def getActualLength(self):
+        return len(self.buffer)
+
+    def getBuffer(self):
+        return self.buffer
+
+    def close(self):
+        pass
+
+
+class Context:
+    def __init__(self, transfers):
+        self.transfers = transfers
+
+    def handleEventsTimeout(self, timeout):
+        # Complete the oldest submitted transfer, like the bus would
+        for transfer in self.transfers:
+            if transfer.isSubmitted():
+                transfer.complete()
+                return
+
+    def close(self):
+        pass
+
+
+class Handle:
+    def claimInterface(self, ifnum):
+        pass
+
+    def releaseInterface(self, ifnum):
+        pass
+
+    def close(self):
+        pass
+
+
+def pyusb_backend(freejtag, probe):
+    backend = freejtag.Backend.__new__(freejtag.Backend)
+    backend._device = PyUSBDevice(probe, freejtag.usb)
+    backend._intf = types.SimpleNamespace(bInterfaceNumber=0)
+    backend._bmRequestType_out = 0x41
+    backend._bmRequestType_in = 0xC1
+    backend.transfers = 0
+    return backend
+
+
+def libusb_backend(libusb, probe):
+    backend = libusb.Backend.__new__(libusb.Backend)
+    transfers = [Transfer(probe) for _ in range(4)]
+    backend._context = Context(transfers)
+    backend._handle = Handle()
+    backend._ifnum = 0
+    backend._free = deque(transfers)
+    backend._inflight = deque()
+    backend._pending = {}
+    backend._error = None
+    backend.transfers = 0
+    return backend
+
+
+def make_jtag(backend):
+    jtag = JTAG('sim')
+    jtag.backend = backend
+    return jtag
+
+
+@pytest.mark.parametrize('make', (pyusb_backend, libusb_backend))
+def test_ocd_regs_supported(backends, make):
+    freejtag, libusb = backends
+    backend = make(freejtag if make is pyusb_backend else libusb, Probe())
+    with make_jtag(backend):
+        assert backend.has_ocd_regs
+        assert backend.arena_size == 64
+        assert backend.xsvf_max_bits == 128
+
+
+@pytest.mark.parametrize('make', (pyusb_backend, libusb_backend))
+def test_ocd_regs_stall_falls_back(backends, make):
+    freejtag, libusb = backends
+    probe = Probe(stalls=(REQ_OCDREGS,))
+    backend = make(freejtag if make is pyusb_backend else libusb, probe)
+    with make_jtag(backend) as jtag:
+        assert not backend.has_ocd_regs
+        # Single register access, no further batch requests
+        probe.requests.clear()
+        assert jtag.avr_ocd_regs([(OCD_BCR, 0x55), (OCD_BCR, None)]) == [0]
+        assert REQ_OCDREGS not in probe.requests
+
+
+@pytest.mark.parametrize('make', (pyusb_backend, libusb_backend))
+def test_xsvf_stall_plays_on_host(backends, make):
+    freejtag, libusb = backends
+    probe = Probe(stalls=(REQ_XSVF,))
+    backend = make(freejtag if make is pyusb_backend else libusb, probe)
+    with make_jtag(backend) as jtag:
+        assert backend.xsvf_max_bits == 0
+        probe.requests.clear()
+        # The fake probe reads TDO as zeros, so a zero check passes
+        assert xsvf.play(jtag, bytes((xsvf.XSDRSIZE,)) +
+                (8).to_bytes(4, 'big') + bytes((xsvf.XTDOMASK, 0xFF,
+                xsvf.XSDRTDO, 0x00, 0x00, xsvf.XCOMPLETE))) == \
+                xsvf.STATUS_COMPLETE
+        assert REQ_XSVF not in probe.requests
+
+
+class NativeDevice:
+    """libfreejtag.Device with the arena libfreejtag read off the probe"""
+
+    def __init__(self, stalls=(), **kwargs):
+        self.stalls = stalls
+        self.scans = []
+        self.batches = []
+        self.closed = False
+
+    def arena_size(self):
+        return 64
+
+    def attach(self, attach=True):
+        pass
+
+    def set_state(self, state):
+        pass
+
+    def scan(self, bits, tdi=None, tdo=None, exit=True, tdi_offset=0,
+            tdo_offset=0):
+        self.scans.append(bits)
+
+    def avr_ocd_regs(self, entries):
+        if REQ_OCDREGS in self.stalls:
+            raise FreeJTAGError('Input/output error')
+        self.batches.append(entries)
+        return bytes(2 * sum(not reg & 0xC0 for reg in entries[::3]))
+
+    def close(self):
+        self.closed = True
+
+
+def test_native_scans_fit_arena(monkeypatch):
+    from pyjtag.backends import native
+    monkeypatch.setattr(native, 'Device', NativeDevice)
+    with JTAG('native') as jtag:
+        assert jtag.backend.max_scan_bits == 512
+        jtag.shift_dr(1000, 0)
+        assert jtag.backend._device.scans == [512, 488]
+
+
+def test_native_exit_closes_device(monkeypatch):
+    from pyjtag.backends import native
+    monkeypatch.setattr(native, 'Device', NativeDevice)
+    with JTAG('native') as jtag:
+        device = jtag.backend._device
+        assert not device.closed
+    assert device.closed
+
+
+@pytest.mark.parametrize('stalls', ((), (REQ_OCDREGS,)))
+def test_native_ocd_regs(monkeypatch, stalls):
+    from pyjtag.backends import native
+    monkeypatch.setattr(native, 'Device',
+            lambda **kwargs: NativeDevice(stalls, **kwargs))
+    with JTAG('native') as jtag:
+        assert jtag.backend.has_ocd_regs == (not stalls)
+        assert jtag.avr_ocd_regs([(OCD_BCR, 0x55), (OCD_BCR, None)]) == [0]
+        # The probe query and, when supported, the whole batch at once
+        assert jtag.backend._device.batches == ([] if stalls else
+                [b'', bytes((0x80 | OCD_BCR, 0x55, 0, OCD_BCR, 0, 0))])
@@ -0,0 +1,130 @@
+# SPDX-License-Identifier: MIT
+#
+# Copyright (C) 2026 Jeff Kent <jeff@jkent.net>
+
+import struct
+
+import pytest
+
+from pyjtag import xsvf
+from pyjtag.jtag import JTAG, IR_IDCODE
+
+
+def idcode_xsvf(idcode):
+    data = bytes((xsvf.XCOMMENT,)) + b'read IDCODE\0'
+    data += bytes((xsvf.XSTATE, 0, xsvf.XSTATE, 1, xsvf.XREPEAT, 2))
+    data += bytes((xsvf.XRUNTEST,)) + struct.pack('>I', 5)
+    data += bytes((xsvf.XSIR, 4, 0x01))
+    data += bytes((xsvf.XSDRSIZE,)) + struct.pack('>I', 32)
+    data += bytes((xsvf.XTDOMASK,)) + b'\xff' * 4
+    data += bytes((xsvf.XSDRTDO,)) + b'\0' * 4 + struct.pack('>I', idcode)
+    data += bytes((xsvf.XENDDR, 1, xsvf.XSDR)) + b'\0' * 4
+    data += bytes((xsvf.XWAIT, 6, 1)) + struct.pack('>I', 3)
+    return data + bytes((xsvf.XCOMPLETE,))
+
+
+class Device:
+    """Stands in for a probe with the on-device player."""
+
+    def __init__(self, status):
+        self.status = status
+        self.chunks = []
+
+    def xsvf_write(self, data, start=False):
+        self.chunks.append((bytes(data), start))
+
+    def xsvf_status(self):
+        return self.status
+
+
+@pytest.fixture
+def jtag():
+    with JTAG('sim') as jtag:
+        yield jtag
+
+
+def test_idcode(jtag):
+    assert xsvf.play(jtag, idcode_xsvf(0x8950203F)) == xsvf.STATUS_COMPLETE
+
+
+def test_mismatch(jtag):
+    with pytest.raises(xsvf.XSVFError) as e:
+        xsvf.play(jtag, idcode_xsvf(0x12345678))
+    assert e.value.status == xsvf.STATUS_TDOMISMATCH
+    assert e.value.cmd == xsvf.XSDRTDO
+
+
+def busy_target(jtag, captures):
+    """Make the IDCODE read 0 for the first few captures."""
+    target = jtag.backend.target
+    register = target.registers[IR_IDCODE]
+    count = []
+    capture_dr = target.capture_dr
+
+    def capture():
+        if target.instruction == IR_IDCODE:
+            count.append(1)
+            register.value = 0 if len(count) <= captures else 0x8950203F
+        capture_dr()
+    target.capture_dr = capture
+    return count
+
+
+def test_retry_recaptures(jtag):
+    # XREPEAT 2 allows two retries, each must capture the DR again
+    count = busy_target(jtag, 2)
+    assert xsvf.play(jtag, idcode_xsvf(0x8950203F)) == xsvf.STATUS_COMPLETE
+    assert len(count) == 4
+
+
+def test_retry_gives_up(jtag):
+    busy_target(jtag, 3)
+    with pytest.raises(xsvf.XSVFError) as e:
+        xsvf.play(jtag, idcode_xsvf(0x8950203F))
+    assert e.value.status == xsvf.STATUS_TDOMISMATCH
+
+
+def test_retry_does_not_read_back_tdi(jtag):
+    # Shifting the expected value in must not make a retry pass
+    data = idcode_xsvf(0x12345678)
+    pos = data.index(bytes((xsvf.XSDRTDO,))) + 1
+    data = data[:pos] + struct.pack('>I', 0x12345678) + data[pos + 4:]
+    with pytest.raises(xsvf.XSVFError) as e:
+        xsvf.play(jtag, data)
+    assert e.value.status == xsvf.STATUS_TDOMISMATCH
+    assert e.value.cmd == xsvf.XSDRTDO
+
+
+def test_illegal_command(jtag):
+    with pytest.raises(xsvf.XSVFError) as e:
+        xsvf.play(jtag, b'\x42')
+    assert e.value.status == xsvf.STATUS_ILLEGALCMD
+
+
+def test_max_vector_bits():
+    assert xsvf.max_vector_bits(idcode_xsvf(0)) == 32
+
+
+def test_play_device_chunks():
+    device = Device((xsvf.STATUS_READY, 0, 0))
+    data = idcode_xsvf(0x8950203F)
+    assert xsvf.play_device(device, data, chunk=16) == xsvf.STATUS_READY
+    assert b''.join(chunk for chunk, _ in device.chunks) == data
+    assert [start for _, start in device.chunks][:2] == [True, False]
+
+
+def test_play_device_error():
+    device = Device((xsvf.STATUS_TDOMISMATCH, xsvf.XSDRTDO, 30))
+    with pytest.raises(xsvf.XSVFError):
+        xsvf.play_device(device, idcode_xsvf(0))
+
+
+def test_play_device_empty():
+    assert xsvf.play_device(Device(None), b'') == xsvf.STATUS_READY
+
+
+def test_play_without_device_limit(jtag):
+    # A probe that never reported its limit plays on the host
+    jtag.backend.xsvf_write = None
+    jtag.backend.xsvf_max_bits = None
+    assert xsvf.play(jtag, idcode_xsvf(0x8950203F)) == xsvf.STATUS_COMPLETE
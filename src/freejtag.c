@@ -8,6 +8,9 @@
 #include <LUFA/Drivers/USB/USB.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
+#include <util/delay.h>
+#include <util/delay_basic.h>
 
 #include "descriptors.h"
 #include "freejtag_pins.h"
@@ -42,9 +45,18 @@
     !!(FREEJTAG_TDO_PIN & FREEJTAG_TDO_BIT); \
 })
 
+/* Each unit of tck_delay stretches both TCK half periods by 3 cycles */
+#define FREEJTAG_DELAY() ({ \
+    if (tck_delay) { \
+        _delay_loop_1(tck_delay); \
+    } \
+})
+
 #define FREEJTAG_CLOCK() ({ \
     FREEJTAG_TCK(1); \
+    FREEJTAG_DELAY(); \
     FREEJTAG_TCK(0); \
+    FREEJTAG_DELAY(); \
 })
 
 typedef enum {
@@ -73,8 +85,11 @@ typedef enum {
     FREEJTAG_REQ_EXECUTE,                   // OUT
     FREEJTAG_REQ_READBUF,                   // IN
     FREEJTAG_REQ_BULKBYTE,                  // OUT & IN
+    FREEJTAG_REQ_ARENA,                     // IN
 #if !defined(MINI_FREEJTAG)
     FREEJTAG_REQ_READOCDR           = 0x80, // IN
+    FREEJTAG_REQ_XSVF,                      // OUT & IN
+    FREEJTAG_REQ_OCDREGS,                   // OUT
 #endif
 } freejtag_req_t;
 
@@ -87,6 +102,7 @@ typedef enum {
     FREEJTAG_CMD_CLOCK,
     FREEJTAG_CMD_SHIFT,
     FREEJTAG_CMD_SHIFT_EXIT,
+    FREEJTAG_CMD_SET_DELAY,
     FREEJTAG_CMD_SHIFT_OUT          = 0x40,
     FREEJTAG_CMD_SHIFT_OUT_EXIT,
     FREEJTAG_CMD_SHIFT_IN           = 0x80,
@@ -95,16 +111,97 @@ typedef enum {
     FREEJTAG_CMD_SHIFT_OUTIN_EXIT,
 } freejtag_cmd_t;
 
+#if !defined(MINI_FREEJTAG)
+typedef enum {
+    FREEJTAG_XSVF_XCOMPLETE         = 0x00,
+    FREEJTAG_XSVF_XTDOMASK,
+    FREEJTAG_XSVF_XSIR,
+    FREEJTAG_XSVF_XSDR,
+    FREEJTAG_XSVF_XRUNTEST,
+    FREEJTAG_XSVF_XREPEAT           = 0x07,
+    FREEJTAG_XSVF_XSDRSIZE,
+    FREEJTAG_XSVF_XSDRTDO,
+    FREEJTAG_XSVF_XSTATE            = 0x12,
+    FREEJTAG_XSVF_XENDIR,
+    FREEJTAG_XSVF_XENDDR,
+    FREEJTAG_XSVF_XSIR2,
+    FREEJTAG_XSVF_XCOMMENT,
+    FREEJTAG_XSVF_XWAIT,
+} freejtag_xsvf_cmd_t;
+
+typedef enum {
+    FREEJTAG_XSVF_READY             = 0x00,
+    FREEJTAG_XSVF_COMPLETE,
+    FREEJTAG_XSVF_ERROR_TDOMISMATCH,
+    FREEJTAG_XSVF_ERROR_ILLEGALCMD,
+    FREEJTAG_XSVF_ERROR_ILLEGALSTATE,
+    FREEJTAG_XSVF_ERROR_DATAOVERFLOW,
+} freejtag_xsvf_status_t;
+
+typedef enum {
+    FREEJTAG_XSVF_FIELD_CMD         = 0x00,
+    FREEJTAG_XSVF_FIELD_SCALAR,
+    FREEJTAG_XSVF_FIELD_VECTOR,
+    FREEJTAG_XSVF_FIELD_STRING,
+} freejtag_xsvf_field_t;
+
+#define FREEJTAG_XSVF_FLAG_START    0x01
+#define FREEJTAG_XSVF_MAX_BYTES     (FREEJTAG_ARENA_SIZE / 4)
+#define FREEJTAG_OCD_WRITE          0x80
+#define FREEJTAG_OCD_EXEC           0x40
+#endif
+
+#define IR_AVR_EXEC         10
 #define IR_AVR_OCD          11
+#define IR_UNKNOWN          0xff
 #define AVR_OCD_OCDR        12
 #define AVR_OCD_CTRLSTATUS  13
 
+/* Half of the 512 bytes of SRAM, the rest holds LUFA, the other statics
+ * and the stack.  The check_ram make target fails the build when less than
+ * STACK_RESERVE bytes are left for the stack. */
+#if !defined(FREEJTAG_ARENA_SIZE)
+#define FREEJTAG_ARENA_SIZE 256
+#endif
+
 static freejtag_state_t state;
-static uint8_t rxbuf[FIXED_CONTROL_ENDPOINT_SIZE];
-static uint8_t txbuf[FIXED_CONTROL_ENDPOINT_SIZE];
-static uint8_t rxlen, txlen;
+static uint8_t tck_delay;
+/* Instruction loaded by the built-in sequences, IR_UNKNOWN once anything
+ * else may have scanned the IR */
+static uint8_t ir_shadow;
+/* Shared scan buffer, TDI is shifted out of it and TDO back in place */
+static uint8_t arena[FREEJTAG_ARENA_SIZE];
+static uint16_t rxlen, txlen;
+
+#if !defined(MINI_FREEJTAG)
+/* XSVF player state.  The arena is split in four, the scan itself, then
+ * the sticky TDI, expected TDO and mask vectors. */
+static struct {
+    uint8_t status;
+    uint8_t cmd;
+    uint8_t field;
+    uint8_t arg;
+    uint16_t count;
+    uint8_t *dst;
+    uint32_t value;
+    uint32_t offset;
+    uint32_t cmd_offset;
+    uint32_t runtest;
+    uint16_t sdr_bits;
+    uint16_t sir_bits;
+    uint8_t repeat;
+    uint8_t endir;
+    uint8_t enddr;
+    uint8_t wait_state;
+    uint8_t end_state;
+} xsvf;
+static uint8_t *const xsvf_tdi = &arena[FREEJTAG_XSVF_MAX_BYTES];
+static uint8_t *const xsvf_tdo = &arena[2 * FREEJTAG_XSVF_MAX_BYTES];
+static uint8_t *const xsvf_mask = &arena[3 * FREEJTAG_XSVF_MAX_BYTES];
+#endif
 
 static void FreeJTAG_Attach(bool attach);
+static int FreeJTAG_Bits(uint8_t val);
 static void FreeJTAG_SetState(freejtag_state_t new_state);
 static void FreeJTAG_ShiftExit(void);
 static void FreeJTAG_Shift(int bits, bool exit);
@@ -115,13 +212,23 @@ static void FreeJTAG_BulkWrite(void);
 static void FreeJTAG_BulkRead(void);
 #if !defined(MINI_FREEJTAG)
 static uint32_t FreeJTAG_ShiftOutIn(int bits, uint32_t value);
+static void FreeJTAG_AVR_SelectIR(uint8_t ir);
 static int16_t FreeJTAG_AVR_ReadOCDR(void);
+static void FreeJTAG_AVR_OCDRegs(void);
+static void FreeJTAG_XSVF_Reset(void);
+static void FreeJTAG_XSVF_Stream(uint16_t length);
+static void FreeJTAG_XSVF_Feed(uint8_t byte);
 #endif
 
 void FreeJTAG_Init(void)
 {
     state = FREEJTAG_STATE_UNKNOWN;
     txlen = 0;
+    tck_delay = 0;
+    ir_shadow = IR_UNKNOWN;
+#if !defined(MINI_FREEJTAG)
+    FreeJTAG_XSVF_Reset();
+#endif
 }
 
 void FreeJTAG_ControlRequest(void)
@@ -153,21 +260,29 @@ void FreeJTAG_ControlRequest(void)
 
         case FREEJTAG_REQ_READBUF:
             Endpoint_ClearSETUP();
-            Endpoint_Write_Control_Stream_LE(txbuf, txlen);
+            Endpoint_Write_Control_Stream_LE(arena, txlen);
             Endpoint_ClearOUT();
             txlen = 0;
             break;
 
         case FREEJTAG_REQ_BULKBYTE:
             Endpoint_ClearSETUP();
-            txlen = USB_ControlRequest.wLength < FIXED_CONTROL_ENDPOINT_SIZE ?
-                    USB_ControlRequest.wLength : FIXED_CONTROL_ENDPOINT_SIZE;
+            txlen = USB_ControlRequest.wLength < FREEJTAG_ARENA_SIZE ?
+                    USB_ControlRequest.wLength : FREEJTAG_ARENA_SIZE;
             FreeJTAG_BulkRead();
-            Endpoint_Write_Control_Stream_LE(txbuf, txlen);
+            Endpoint_Write_Control_Stream_LE(arena, txlen);
             Endpoint_ClearOUT();
             txlen = 0;
             break;
 
+        case FREEJTAG_REQ_ARENA: {
+                const uint16_t size = FREEJTAG_ARENA_SIZE;
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(&size, sizeof(size));
+                Endpoint_ClearOUT();
+                break;
+            }
+
 #if !defined(MINI_FREEJTAG)
         case FREEJTAG_REQ_READOCDR: {
                 int16_t value = FreeJTAG_AVR_ReadOCDR();
@@ -176,6 +291,18 @@ void FreeJTAG_ControlRequest(void)
                 Endpoint_ClearOUT();
             }
             break;
+
+        case FREEJTAG_REQ_XSVF: {
+                uint8_t report[6];
+
+                report[0] = xsvf.status;
+                report[1] = xsvf.cmd;
+                memcpy(&report[2], &xsvf.cmd_offset, sizeof(uint32_t));
+                Endpoint_ClearSETUP();
+                Endpoint_Write_Control_Stream_LE(report, sizeof(report));
+                Endpoint_ClearOUT();
+            }
+            break;
 #endif
         }
     } else {
@@ -184,6 +311,7 @@ void FreeJTAG_ControlRequest(void)
             Endpoint_ClearSETUP();
             Endpoint_ClearStatusStage();
             state = FREEJTAG_STATE_UNKNOWN;
+            ir_shadow = IR_UNKNOWN;
             txlen = 0;
             break;
 
@@ -204,6 +332,7 @@ void FreeJTAG_ControlRequest(void)
 
                 case FREEJTAG_CMD_SET_TMS:
                    FREEJTAG_TMS(!!val);
+                   ir_shadow = IR_UNKNOWN;
                    break;
 
                 case FREEJTAG_CMD_SET_STATE:
@@ -221,18 +350,22 @@ void FreeJTAG_ControlRequest(void)
 
                 case FREEJTAG_CMD_SHIFT:
                 case FREEJTAG_CMD_SHIFT_EXIT: {
-                        int bits = val + 1;
+                        int bits = FreeJTAG_Bits(val);
 
                         FreeJTAG_Shift(bits, cmd == FREEJTAG_CMD_SHIFT_EXIT);
                     }
                     break;
 
+                case FREEJTAG_CMD_SET_DELAY:
+                    tck_delay = val;
+                    break;
+
                 case FREEJTAG_CMD_SHIFT_OUT:
                 case FREEJTAG_CMD_SHIFT_OUT_EXIT: {
-                        int bits = val + 1;
+                        int bits = FreeJTAG_Bits(val);
 
                         rxlen = (bits + 7) / 8;
-                        Endpoint_Read_Control_Stream_LE(rxbuf, rxlen);
+                        Endpoint_Read_Control_Stream_LE(arena, rxlen);
                         FreeJTAG_ShiftOutBuf(bits,
                                 cmd == FREEJTAG_CMD_SHIFT_OUT_EXIT);
                     }
@@ -240,7 +373,7 @@ void FreeJTAG_ControlRequest(void)
 
                 case FREEJTAG_CMD_SHIFT_IN:
                 case FREEJTAG_CMD_SHIFT_IN_EXIT: {
-                        int bits = val + 1;
+                        int bits = FreeJTAG_Bits(val);
 
                         txlen = (bits + 7) / 8;
                         FreeJTAG_ShiftInBuf(bits,
@@ -250,11 +383,11 @@ void FreeJTAG_ControlRequest(void)
 
                 case FREEJTAG_CMD_SHIFT_OUTIN:
                 case FREEJTAG_CMD_SHIFT_OUTIN_EXIT: {
-                        int bits = val + 1;
+                        int bits = FreeJTAG_Bits(val);
 
                         rxlen = (bits + 7) / 8;
                         txlen = (bits + 7) / 8;
-                        Endpoint_Read_Control_Stream_LE(rxbuf, rxlen);
+                        Endpoint_Read_Control_Stream_LE(arena, rxlen);
                         FreeJTAG_ShiftOutInBuf(bits,
                                 cmd == FREEJTAG_CMD_SHIFT_OUTIN_EXIT);
                     }
@@ -265,17 +398,49 @@ void FreeJTAG_ControlRequest(void)
             break;
 
         case FREEJTAG_REQ_BULKBYTE:
-            rxlen = USB_ControlRequest.wLength < FIXED_CONTROL_ENDPOINT_SIZE ?
-                    USB_ControlRequest.wLength : FIXED_CONTROL_ENDPOINT_SIZE;
+            rxlen = USB_ControlRequest.wLength < FREEJTAG_ARENA_SIZE ?
+                    USB_ControlRequest.wLength : FREEJTAG_ARENA_SIZE;
             Endpoint_ClearSETUP();
-            Endpoint_Read_Control_Stream_LE(rxbuf, rxlen);
+            Endpoint_Read_Control_Stream_LE(arena, rxlen);
             FreeJTAG_BulkWrite();
             Endpoint_ClearStatusStage();
             break;
+
+#if !defined(MINI_FREEJTAG)
+        case FREEJTAG_REQ_XSVF:
+            Endpoint_ClearSETUP();
+            if (USB_ControlRequest.wValue & FREEJTAG_XSVF_FLAG_START) {
+                FreeJTAG_XSVF_Reset();
+            }
+            FreeJTAG_XSVF_Stream(USB_ControlRequest.wLength);
+            Endpoint_ClearStatusStage();
+            txlen = 0;
+            break;
+
+        case FREEJTAG_REQ_OCDREGS:
+            rxlen = USB_ControlRequest.wLength < FREEJTAG_ARENA_SIZE ?
+                    USB_ControlRequest.wLength : FREEJTAG_ARENA_SIZE;
+            Endpoint_ClearSETUP();
+            Endpoint_Read_Control_Stream_LE(arena, rxlen);
+            FreeJTAG_AVR_OCDRegs();
+            Endpoint_ClearStatusStage();
+            break;
+#endif
         }
     }
 }
 
+/* The high byte of wIndex extends shift lengths past 256 bits */
+static int FreeJTAG_Bits(uint8_t val)
+{
+    uint16_t arg = (USB_ControlRequest.wIndex & 0xff00) | val;
+
+    if (arg >= FREEJTAG_ARENA_SIZE * 8) {
+        return FREEJTAG_ARENA_SIZE * 8;
+    }
+    return arg + 1;
+}
+
 static void FreeJTAG_Attach(bool attach)
 {
     if (attach) {
@@ -292,6 +457,7 @@ static void FreeJTAG_Attach(bool attach)
         FREEJTAG_TMS(1);
         FreeJTAG_Shift(1024, false);
         state = FREEJTAG_STATE_RESET;
+        ir_shadow = IR_UNKNOWN;
     } else {
         FREEJTAG_TCK_DDR &= ~FREEJTAG_TCK_BIT;
         FREEJTAG_TDO_DDR &= ~FREEJTAG_TDO_BIT;
@@ -307,6 +473,14 @@ static void FreeJTAG_Attach(bool attach)
 
 static void FreeJTAG_SetState(freejtag_state_t new_state)
 {
+    /* Only RUNIDLE and the DR column leave the IR alone, reset reloads it
+     * and any trip through the IR column can capture and update it */
+    if (new_state != FREEJTAG_STATE_RUNIDLE &&
+            (new_state < FREEJTAG_STATE_DRSELECT ||
+            new_state > FREEJTAG_STATE_DRUPDATE)) {
+        ir_shadow = IR_UNKNOWN;
+    }
+
     FREEJTAG_TDI(1);
 
     switch (new_state) {
@@ -326,6 +500,11 @@ static void FreeJTAG_SetState(freejtag_state_t new_state)
             FREEJTAG_CLOCK();   /* RUNIDLE */
             break;
 
+        case FREEJTAG_STATE_DRPAUSE:
+        case FREEJTAG_STATE_IRPAUSE:
+            FREEJTAG_TMS(1);
+            FREEJTAG_CLOCK();   /* DREXIT2/IREXIT2 */
+
         case FREEJTAG_STATE_DREXIT1:
         case FREEJTAG_STATE_DREXIT2:
         case FREEJTAG_STATE_IREXIT1:
@@ -360,11 +539,19 @@ static void FreeJTAG_SetState(freejtag_state_t new_state)
             FREEJTAG_CLOCK();   /* DRSHIFT */
             break;
 
+        case FREEJTAG_STATE_DRPAUSE:
+            FREEJTAG_TMS(1);
+            FREEJTAG_CLOCK();   /* DREXIT2 */
+
         case FREEJTAG_STATE_DREXIT2:
             FREEJTAG_TMS(0);
             FREEJTAG_CLOCK();   /* DRSHIFT */
             break;
 
+        case FREEJTAG_STATE_IRPAUSE:
+            FREEJTAG_TMS(1);
+            FREEJTAG_CLOCK();   /* IREXIT2 */
+
         case FREEJTAG_STATE_IREXIT1:
         case FREEJTAG_STATE_IREXIT2:
             FREEJTAG_TMS(1);
@@ -449,11 +636,19 @@ static void FreeJTAG_SetState(freejtag_state_t new_state)
             FREEJTAG_CLOCK();   /* IRSHIFT */
             break;
 
+        case FREEJTAG_STATE_IRPAUSE:
+            FREEJTAG_TMS(1);
+            FREEJTAG_CLOCK();   /* IREXIT2 */
+
         case FREEJTAG_STATE_IREXIT2:
             FREEJTAG_TMS(0);
             FREEJTAG_CLOCK();   /* IRSHIFT */
             break;
 
+        case FREEJTAG_STATE_DRPAUSE:
+            FREEJTAG_TMS(1);
+            FREEJTAG_CLOCK();   /* DREXIT2 */
+
         case FREEJTAG_STATE_DREXIT1:
         case FREEJTAG_STATE_DREXIT2:
             FREEJTAG_TMS(1);
@@ -578,7 +773,7 @@ static void FreeJTAG_ShiftOutBuf(int bits, bool exit)
     for (bit = 0; bit < bits - 1; bit++) {
         if ((bit & 7) == 0) {
             i = bit >> 3;
-            byte = rxbuf[i];
+            byte = arena[i];
         }
         FREEJTAG_TDI(byte & 1);
         byte >>= 1;
@@ -591,7 +786,7 @@ static void FreeJTAG_ShiftOutBuf(int bits, bool exit)
 
     if ((bit & 7) == 0) {
         i = bit >> 3;
-        byte = rxbuf[i];
+        byte = arena[i];
     }
     FREEJTAG_TDI(byte & 1);
     byte >>= 1;
@@ -617,7 +812,7 @@ static void FreeJTAG_ShiftInBuf(int bits, bool exit)
         }
         FREEJTAG_CLOCK();
         if ((bit & 7) == 7) {
-            txbuf[i] = byte;
+            arena[i] = byte;
         }
     }
 
@@ -637,7 +832,7 @@ static void FreeJTAG_ShiftInBuf(int bits, bool exit)
         byte &= ~mask;
     }
     FREEJTAG_CLOCK();
-    txbuf[i] = byte;
+    arena[i] = byte;
 }
 
 static void FreeJTAG_ShiftOutInBuf(int bits, bool exit)
@@ -648,7 +843,7 @@ static void FreeJTAG_ShiftOutInBuf(int bits, bool exit)
     for (bit = 0; bit < bits - 1; bit++) {
         if ((bit & 7) == 0) {
             i = bit >> 3;
-            byte = rxbuf[i];
+            byte = arena[i];
             mask = bits - bit >= 8 ? 0x80 : 1 << ((bits - 1) & 7);
         }
         FREEJTAG_TDI(byte & 1);
@@ -660,7 +855,7 @@ static void FreeJTAG_ShiftOutInBuf(int bits, bool exit)
         }
         FREEJTAG_CLOCK();
         if ((bit & 7) == 7) {
-            txbuf[i] = byte;
+            arena[i] = byte;
         }
     }
 
@@ -670,7 +865,7 @@ static void FreeJTAG_ShiftOutInBuf(int bits, bool exit)
 
     if ((bit & 7) == 0) {
         i = bit >> 3;
-        byte = rxbuf[i];
+        byte = arena[i];
         mask = 0x01;
     }
     FREEJTAG_TDI(byte & 1);
@@ -681,15 +876,15 @@ static void FreeJTAG_ShiftOutInBuf(int bits, bool exit)
         byte &= ~mask;
     }
     FREEJTAG_CLOCK();
-    txbuf[i] = byte;
+    arena[i] = byte;
 }
 
 static void FreeJTAG_BulkWrite(void)
 {
     uint8_t byte;
 
-    for (uint8_t i = 0; i < rxlen; i++) {
-        byte = rxbuf[i];
+    for (uint16_t i = 0; i < rxlen; i++) {
+        byte = arena[i];
         FreeJTAG_SetState(FREEJTAG_STATE_DRSHIFT);
         for (int bit = 0; bit < 7; bit++) {
             FREEJTAG_TDI(byte & 1);
@@ -707,7 +902,7 @@ static void FreeJTAG_BulkRead(void)
 {
     uint8_t byte = 0;
 
-    for (uint8_t i = 0; i < txlen; i++) {
+    for (uint16_t i = 0; i < txlen; i++) {
         FreeJTAG_SetState(FREEJTAG_STATE_DRSHIFT);
         for (int bit = 0; bit < 7; bit++) {
             byte >>= 1;
@@ -726,7 +921,7 @@ static void FreeJTAG_BulkRead(void)
             byte &= ~0x80;
         }
         FREEJTAG_CLOCK();
-        txbuf[i] = byte;
+        arena[i] = byte;
         FreeJTAG_SetState(FREEJTAG_STATE_RUNIDLE);
     }
 }
@@ -734,7 +929,7 @@ static void FreeJTAG_BulkRead(void)
 #if !defined(MINI_FREEJTAG)
 static uint32_t FreeJTAG_ShiftOutIn(int bits, uint32_t value)
 {
-    int mask = 1ULL << (bits - 1);
+    uint32_t mask = 1UL << (bits - 1);
 
     for (int bit = 0; bit < bits - 1; bit++) {
         FREEJTAG_TDI(value & 1);
@@ -760,15 +955,24 @@ static uint32_t FreeJTAG_ShiftOutIn(int bits, uint32_t value)
     return value & ((1ULL << bits) - 1);
 }
 
+static void FreeJTAG_AVR_SelectIR(uint8_t ir)
+{
+    if (ir_shadow == ir) {
+        return;
+    }
+    FreeJTAG_SetState(FREEJTAG_STATE_IRSHIFT);
+    FreeJTAG_ShiftOutIn(4, ir);
+    FreeJTAG_SetState(FREEJTAG_STATE_RUNIDLE);
+    ir_shadow = ir;
+}
+
+/* Leaves IR_AVR_OCD selected so back to back polls skip the IR scan */
 static int16_t FreeJTAG_AVR_ReadOCDR(void)
 {
-    uint8_t ir;
     uint16_t status;
     int16_t value = -1;
 
-    FreeJTAG_SetState(FREEJTAG_STATE_IRSHIFT);
-    ir = FreeJTAG_ShiftOutIn(4, IR_AVR_OCD);
-    FreeJTAG_SetState(FREEJTAG_STATE_RUNIDLE);
+    FreeJTAG_AVR_SelectIR(IR_AVR_OCD);
 
     FreeJTAG_SetState(FREEJTAG_STATE_DRSHIFT);
     FreeJTAG_ShiftOutIn(5, AVR_OCD_CTRLSTATUS);
@@ -788,10 +992,336 @@ static int16_t FreeJTAG_AVR_ReadOCDR(void)
         FreeJTAG_SetState(FREEJTAG_STATE_RUNIDLE);
     }
 
-    FreeJTAG_SetState(FREEJTAG_STATE_IRSHIFT);
-    FreeJTAG_ShiftOutIn(4, ir);
-    FreeJTAG_SetState(FREEJTAG_STATE_RUNIDLE);
-
     return value;
 }
+
+/* Entries are 3 bytes, the register with FREEJTAG_OCD_WRITE for writes
+ * followed by a 16 bit little endian value (ignored for reads).  With
+ * FREEJTAG_OCD_EXEC the value is an instruction run on the stopped core
+ * instead.  Read values are packed in place from the start of the arena
+ * for READBUF, never past the entry being run. */
+static void FreeJTAG_AVR_OCDRegs(void)
+{
+    txlen = 0;
+
+    for (uint16_t i = 0; i + 3 <= rxlen; i += 3) {
+        uint8_t reg = arena[i] & 0x0f;
+        bool write = arena[i] & FREEJTAG_OCD_WRITE;
+        uint16_t value = arena[i + 1] | (arena[i + 2] << 8);
+
+        if (arena[i] & FREEJTAG_OCD_EXEC) {
+            FreeJTAG_AVR_SelectIR(IR_AVR_EXEC);
+            FreeJTAG_SetState(FREEJTAG_STATE_DRSHIFT);
+            FreeJTAG_ShiftOutIn(16, value);
+            FreeJTAG_SetState(FREEJTAG_STATE_RUNIDLE);
+            continue;
+        }
+
+        FreeJTAG_AVR_SelectIR(IR_AVR_OCD);
+        FreeJTAG_SetState(FREEJTAG_STATE_DRSHIFT);
+        FreeJTAG_ShiftOutIn(5, reg);
+        FreeJTAG_SetState(FREEJTAG_STATE_RUNIDLE);
+
+        FreeJTAG_SetState(FREEJTAG_STATE_DRSHIFT);
+        if (write) {
+            FreeJTAG_ShiftOutIn(21, (1UL << 20) | ((uint32_t)reg << 16) |
+                    value);
+        } else {
+            value = FreeJTAG_ShiftOutIn(16, 0);
+            arena[txlen++] = value & 0xff;
+            arena[txlen++] = value >> 8;
+        }
+        FreeJTAG_SetState(FREEJTAG_STATE_RUNIDLE);
+    }
+}
+
+static void FreeJTAG_XSVF_Reset(void)
+{
+    memset(&xsvf, 0, sizeof(xsvf));
+    memset(xsvf_tdo, 0, FREEJTAG_XSVF_MAX_BYTES);
+    memset(xsvf_mask, 0, FREEJTAG_XSVF_MAX_BYTES);
+    xsvf.repeat = 32;
+    xsvf.endir = FREEJTAG_STATE_RUNIDLE;
+    xsvf.enddr = FREEJTAG_STATE_RUNIDLE;
+}
+
+static void FreeJTAG_XSVF_Stream(uint16_t length)
+{
+    /* Each packet is parsed and played straight out of the endpoint bank
+     * before the next one is accepted, so the host is paced by the TAP */
+    while (length) {
+        while (!Endpoint_IsOUTReceived()) {
+            if (USB_DeviceState == DEVICE_STATE_Unattached ||
+                    Endpoint_IsSETUPReceived()) {
+                return;
+            }
+        }
+
+        while (length && Endpoint_BytesInEndpoint()) {
+            FreeJTAG_XSVF_Feed(Endpoint_Read_8());
+            length--;
+        }
+        Endpoint_ClearOUT();
+    }
+}
+
+static void FreeJTAG_XSVF_Expect(freejtag_xsvf_field_t field, uint16_t count,
+        uint8_t *dst)
+{
+    if (field == FREEJTAG_XSVF_FIELD_VECTOR &&
+            count > FREEJTAG_XSVF_MAX_BYTES) {
+        xsvf.status = FREEJTAG_XSVF_ERROR_DATAOVERFLOW;
+        return;
+    }
+    xsvf.field = field;
+    xsvf.count = count;
+    xsvf.dst = dst;
+    xsvf.value = 0;
+}
+
+static bool FreeJTAG_XSVF_Goto(uint8_t new_state)
+{
+    if (new_state > FREEJTAG_STATE_IRUPDATE) {
+        xsvf.status = FREEJTAG_XSVF_ERROR_ILLEGALSTATE;
+        return false;
+    }
+    FreeJTAG_SetState(new_state);
+    if (state != new_state) {
+        xsvf.status = FREEJTAG_XSVF_ERROR_ILLEGALSTATE;
+        return false;
+    }
+    return true;
+}
+
+static void FreeJTAG_XSVF_Wait(uint32_t usecs)
+{
+    FREEJTAG_TMS(state == FREEJTAG_STATE_RESET);
+    while (usecs--) {
+        FREEJTAG_CLOCK();
+        _delay_us(1);
+    }
+}
+
+static bool FreeJTAG_XSVF_Match(uint8_t bytes)
+{
+    for (uint8_t i = 0; i < bytes; i++) {
+        if ((arena[i] ^ xsvf_tdo[i]) & xsvf_mask[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void FreeJTAG_XSVF_ShiftIR(void)
+{
+    if (!FreeJTAG_XSVF_Goto(FREEJTAG_STATE_IRSHIFT)) {
+        return;
+    }
+    FreeJTAG_ShiftOutBuf(xsvf.sir_bits, true);
+    if (FreeJTAG_XSVF_Goto(xsvf.endir)) {
+        FreeJTAG_XSVF_Wait(xsvf.runtest);
+    }
+}
+
+static void FreeJTAG_XSVF_ShiftDR(void)
+{
+    uint32_t runtest = xsvf.runtest;
+    uint8_t bytes = (xsvf.sdr_bits + 7) / 8;
+
+    if (!FreeJTAG_XSVF_Goto(FREEJTAG_STATE_DRSHIFT)) {
+        return;
+    }
+
+    for (uint8_t attempt = 0; ; attempt++) {
+        /* The scan overwrites TDI in place, keep it for retries */
+        memcpy(arena, xsvf_tdi, bytes);
+        FreeJTAG_ShiftOutInBuf(xsvf.sdr_bits, true);
+        if (FreeJTAG_XSVF_Match(bytes)) {
+            break;
+        }
+        if (attempt >= xsvf.repeat) {
+            xsvf.status = FREEJTAG_XSVF_ERROR_TDOMISMATCH;
+            return;
+        }
+        /* Xilinx's retry: back through Pause-DR, then out through
+         * Update-DR to wait 25% longer in Run-Test/Idle, and capture
+         * again on the way to Shift-DR */
+        FreeJTAG_SetState(FREEJTAG_STATE_DRPAUSE);
+        FreeJTAG_SetState(FREEJTAG_STATE_DRSHIFT);
+        FreeJTAG_Shift(1, true);
+        FreeJTAG_SetState(FREEJTAG_STATE_RUNIDLE);
+        runtest += runtest >> 2;
+        FreeJTAG_XSVF_Wait(runtest);
+        FreeJTAG_SetState(FREEJTAG_STATE_DRSHIFT);
+    }
+
+    if (FreeJTAG_XSVF_Goto(xsvf.enddr)) {
+        FreeJTAG_XSVF_Wait(runtest);
+    }
+}
+
+static void FreeJTAG_XSVF_Begin(uint8_t cmd)
+{
+    uint8_t sdr_bytes = (xsvf.sdr_bits + 7) / 8;
+
+    xsvf.cmd = cmd;
+    xsvf.cmd_offset = xsvf.offset;
+    xsvf.arg = 0;
+
+    switch (cmd) {
+    case FREEJTAG_XSVF_XCOMPLETE:
+        xsvf.status = FREEJTAG_XSVF_COMPLETE;
+        break;
+
+    case FREEJTAG_XSVF_XTDOMASK:
+        FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_VECTOR, sdr_bytes,
+                xsvf_mask);
+        break;
+
+    case FREEJTAG_XSVF_XSDR:
+    case FREEJTAG_XSVF_XSDRTDO:
+        FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_VECTOR, sdr_bytes, xsvf_tdi);
+        break;
+
+    case FREEJTAG_XSVF_XSIR:
+    case FREEJTAG_XSVF_XREPEAT:
+    case FREEJTAG_XSVF_XSTATE:
+    case FREEJTAG_XSVF_XENDIR:
+    case FREEJTAG_XSVF_XENDDR:
+    case FREEJTAG_XSVF_XWAIT:
+        FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_SCALAR, 1, NULL);
+        break;
+
+    case FREEJTAG_XSVF_XSIR2:
+        FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_SCALAR, 2, NULL);
+        break;
+
+    case FREEJTAG_XSVF_XRUNTEST:
+    case FREEJTAG_XSVF_XSDRSIZE:
+        FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_SCALAR, 4, NULL);
+        break;
+
+    case FREEJTAG_XSVF_XCOMMENT:
+        FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_STRING, 0, NULL);
+        break;
+
+    default:
+        xsvf.status = FREEJTAG_XSVF_ERROR_ILLEGALCMD;
+        break;
+    }
+}
+
+/* Called as each field completes, either asks for the next one or runs
+ * the command */
+static void FreeJTAG_XSVF_Argument(void)
+{
+    uint32_t value = xsvf.value;
+    uint8_t arg = xsvf.arg++;
+
+    xsvf.field = FREEJTAG_XSVF_FIELD_CMD;
+
+    switch (xsvf.cmd) {
+    case FREEJTAG_XSVF_XSIR:
+    case FREEJTAG_XSVF_XSIR2:
+        if (arg == 0) {
+            xsvf.sir_bits = value;
+            FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_VECTOR,
+                    (value + 7) / 8, arena);
+        } else {
+            FreeJTAG_XSVF_ShiftIR();
+        }
+        break;
+
+    case FREEJTAG_XSVF_XSDR:
+        FreeJTAG_XSVF_ShiftDR();
+        break;
+
+    case FREEJTAG_XSVF_XSDRTDO:
+        if (arg == 0) {
+            FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_VECTOR,
+                    (xsvf.sdr_bits + 7) / 8, xsvf_tdo);
+        } else {
+            FreeJTAG_XSVF_ShiftDR();
+        }
+        break;
+
+    case FREEJTAG_XSVF_XRUNTEST:
+        xsvf.runtest = value;
+        break;
+
+    case FREEJTAG_XSVF_XREPEAT:
+        xsvf.repeat = value;
+        break;
+
+    case FREEJTAG_XSVF_XSDRSIZE:
+        if (value > FREEJTAG_XSVF_MAX_BYTES * 8) {
+            xsvf.status = FREEJTAG_XSVF_ERROR_DATAOVERFLOW;
+        } else {
+            xsvf.sdr_bits = value;
+        }
+        break;
+
+    case FREEJTAG_XSVF_XSTATE:
+        FreeJTAG_XSVF_Goto(value);
+        break;
+
+    case FREEJTAG_XSVF_XENDIR:
+        xsvf.endir = value ? FREEJTAG_STATE_IRPAUSE : FREEJTAG_STATE_RUNIDLE;
+        break;
+
+    case FREEJTAG_XSVF_XENDDR:
+        xsvf.enddr = value ? FREEJTAG_STATE_DRPAUSE : FREEJTAG_STATE_RUNIDLE;
+        break;
+
+    case FREEJTAG_XSVF_XWAIT:
+        if (arg == 0) {
+            xsvf.wait_state = value;
+            FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_SCALAR, 1, NULL);
+        } else if (arg == 1) {
+            xsvf.end_state = value;
+            FreeJTAG_XSVF_Expect(FREEJTAG_XSVF_FIELD_SCALAR, 4, NULL);
+        } else if (FreeJTAG_XSVF_Goto(xsvf.wait_state)) {
+            FreeJTAG_XSVF_Wait(value);
+            FreeJTAG_XSVF_Goto(xsvf.end_state);
+        }
+        break;
+    }
+}
+
+static void FreeJTAG_XSVF_Feed(uint8_t byte)
+{
+    if (xsvf.status != FREEJTAG_XSVF_READY) {
+        return;
+    }
+
+    switch (xsvf.field) {
+    case FREEJTAG_XSVF_FIELD_CMD:
+        FreeJTAG_XSVF_Begin(byte);
+        break;
+
+    case FREEJTAG_XSVF_FIELD_SCALAR:
+        xsvf.value = (xsvf.value << 8) | byte;
+        xsvf.count--;
+        break;
+
+    case FREEJTAG_XSVF_FIELD_VECTOR:
+        /* XSVF vectors are MSB first, the shift kernels want LSB first */
+        xsvf.dst[--xsvf.count] = byte;
+        break;
+
+    case FREEJTAG_XSVF_FIELD_STRING:
+        if (byte == 0) {
+            xsvf.field = FREEJTAG_XSVF_FIELD_CMD;
+        }
+        break;
+    }
+    xsvf.offset++;
+
+    /* Also catches zero length vectors, which take no bytes at all */
+    while (xsvf.status == FREEJTAG_XSVF_READY &&
+            (xsvf.field == FREEJTAG_XSVF_FIELD_SCALAR ||
+            xsvf.field == FREEJTAG_XSVF_FIELD_VECTOR) && xsvf.count == 0) {
+        FreeJTAG_XSVF_Argument();
+    }
+}
 #endif
\ No newline at end of file